@@ -0,0 +1,337 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <string>
+#include <functional>
+#include <tuple>
+#include <algorithm>
+#include <charconv>
+#include "rect.hpp"
+#include "simd.hpp"
+#include "expected_dist.hpp"
+#include "expected_dist_batch.hpp"
+#include "expected_dist_box.hpp"
+#include "box.hpp"
+using namespace fiocca;
+
+// Usage:
+//   edist_bench [--pairs N] [--warmup W] [--reps R] [--json PATH] [--help]
+// Every scenario is timed over N pairs by the scalar and the batched
+// kernels in float, double and long double, W untimed passes and R timed
+// passes each. The accuracy is the maximal relative error against the
+// Gaussian transform of flat boxes in long double, which never takes the
+// far-field expansion, over a sample of the pairs rounded to each
+// precision. The summary goes to the standard output and, if PATH is
+// given, to a JSON file ("-" for the standard output).
+
+namespace {
+
+// Pairs of rectangles as structure-of-arrays, the same as the batch
+// example.
+template<class DataType>
+struct Pairs {
+  explicit Pairs(std::size_t size) : size(size), buffer(size * 8) { }
+
+  auto column(std::size_t k) const {
+    return std::span<const DataType>(buffer).subspan(k * size, size);
+  }
+  auto lhs() const {
+    return RectSpan<DataType> { column(0), column(1), column(2), column(3) };
+  }
+  auto rhs() const {
+    return RectSpan<DataType> { column(4), column(5), column(6), column(7) };
+  }
+  void set(std::size_t i, const Rect<double>& a, const Rect<double>& b) {
+    const double coords[] = { a.x1(), a.x2(), a.y1(), a.y2(),
+                              b.x1(), b.x2(), b.y1(), b.y2() };
+    for (std::size_t k = 0; k != 8; ++k)
+      buffer[k * size + i] = static_cast<DataType>(coords[k]);
+  }
+  auto lhs(std::size_t i) const {
+    return Rect<DataType>(buffer[i], buffer[size + i],
+                          buffer[2 * size + i], buffer[3 * size + i]);
+  }
+  auto rhs(std::size_t i) const {
+    return Rect<DataType>(buffer[4 * size + i], buffer[5 * size + i],
+                          buffer[6 * size + i], buffer[7 * size + i]);
+  }
+
+  std::size_t size;
+  std::vector<DataType> buffer;
+};
+
+template<class DataType>
+constexpr const char* type_name =
+    sizeof(DataType) == sizeof(float)? "float"
+  : sizeof(DataType) == sizeof(double)? "double" : "long double";
+
+/**
+ * @brief A geometric regime and the branch of TwinRect::dist() it takes,
+ *  where the generator draws pairs of rectangles with sides of unit scale.
+ */
+struct Scenario {
+  using generator_t = std::function<std::pair<Rect<double>, Rect<double> >(
+    std::mt19937_64&)>;
+
+  std::string name, branch;
+  generator_t generate;
+};
+
+auto scenarios() -> std::vector<Scenario> {
+  using pair_t = std::pair<Rect<double>, Rect<double> >;
+  static std::uniform_real_distribution<double> side(0.5, 2.0);
+  static std::uniform_real_distribution<double> unit(0.0, 1.0);
+  static std::uniform_real_distribution<double> coord(-10.0, 10.0);
+  auto rect = [](double x, double y, double w, double h) {
+    return Rect<double>(x, x + w, y, y + h);
+  };
+  return {
+    { "overlapping", "CASE 1", [=](auto& gen) -> pair_t {
+        double x = coord(gen), y = coord(gen), w = side(gen), h = side(gen);
+        return { rect(x, y, w, h), rect(x + w * unit(gen), y + h * unit(gen),
+                                        side(gen), side(gen)) };
+      } },
+    { "nested", "CASE 1", [=](auto& gen) -> pair_t {
+        double x = coord(gen), y = coord(gen), w = side(gen), h = side(gen);
+        double u = unit(gen), v = unit(gen);
+        return { rect(x, y, w, h), rect(x + w * u * 0.5, y + h * v * 0.5,
+                                        w * (1 - u) * 0.5, h * (1 - v) * 0.5) };
+      } },
+    { "disjoint-near", "CASE 1", [=](auto& gen) -> pair_t {
+        double x = coord(gen), y = coord(gen), w = side(gen), h = side(gen);
+        return { rect(x, y, w, h), rect(x + w + side(gen), y + coord(gen) / 5,
+                                        side(gen), side(gen)) };
+      } },
+    { "disjoint-far", "FAR FIELD", [=](auto& gen) -> pair_t {
+        double x = coord(gen), y = coord(gen);
+        return { rect(x, y, side(gen), side(gen)),
+                 rect(x + 100 + coord(gen), y + coord(gen) * 10,
+                      side(gen), side(gen)) };
+      } },
+    { "line-line", "CASE 2", [=](auto& gen) -> pair_t {
+        double x = coord(gen), y = coord(gen);
+        return { rect(x, y, 0, side(gen)),
+                 rect(x + side(gen), y + unit(gen), 0, side(gen)) };
+      } },
+    { "point-point", "CASE 2", [=](auto& gen) -> pair_t {
+        double x = coord(gen), y = coord(gen);
+        return { rect(x, y, 0, 0), rect(x + side(gen), y + side(gen), 0, 0) };
+      } },
+    { "line-rect", "CASE 3", [=](auto& gen) -> pair_t {
+        double x = coord(gen), y = coord(gen);
+        return { rect(x, y, 0, side(gen)),
+                 rect(x + unit(gen), y + unit(gen), side(gen), side(gen)) };
+      } },
+    { "point-rect", "CASE 3", [=](auto& gen) -> pair_t {
+        double x = coord(gen), y = coord(gen);
+        return { rect(x, y, 0, 0),
+                 rect(x - unit(gen), y - unit(gen), side(gen), side(gen)) };
+      } },
+    // The branch is taken in float, while the wider types take CASE 1.
+    { "thin", "PROMOTION", [=](auto& gen) -> pair_t {
+        double x = coord(gen), y = coord(gen), w = side(gen);
+        return { rect(x, y, w, side(gen) * 1e-3),
+                 rect(x + w * unit(gen), y + unit(gen),
+                      side(gen), side(gen) * 1e-3) };
+      } }
+  };
+}
+
+// Statistics of the timed passes in nanoseconds per pair.
+struct Timing {
+  double mean, stddev, min, rate_mean, rate_stddev;
+};
+
+auto measure(const std::function<void()>& pass, std::size_t pairs,
+             std::size_t warmup, std::size_t reps) -> Timing {
+  for (std::size_t r = 0; r < warmup; ++r) pass();
+  std::vector<double> ns(reps), rate(reps);
+  for (std::size_t r = 0; r < reps; ++r) {
+    auto t1 = std::chrono::steady_clock::now();
+    pass();
+    auto t2 = std::chrono::steady_clock::now();
+    ns[r] = std::chrono::duration<double, std::nano>(t2 - t1).count() / pairs;
+    rate[r] = 1e9 / ns[r];
+  }
+  auto stats = [&](const std::vector<double>& xs) {
+    double mean = 0, var = 0;
+    for (double x : xs) mean += x;
+    mean /= xs.size();
+    for (double x : xs) var += (x - mean) * (x - mean);
+    return std::make_pair(mean, xs.size() > 1
+                                ? std::sqrt(var / (xs.size() - 1)) : 0);
+  };
+  auto [ mean, stddev ] = stats(ns);
+  auto [ rate_mean, rate_stddev ] = stats(rate);
+  return { mean, stddev, *std::ranges::min_element(ns),
+           rate_mean, rate_stddev };
+}
+
+// The options of the command line.
+struct Options {
+  std::size_t pairs = 1 << 16, warmup = 2, reps = 10, sample = 512;
+  // The limit of pairs, whose buffers already take about 3 GB.
+  static constexpr std::size_t max_pairs = std::size_t(1) << 24;
+};
+
+// Time both kernels of a scenario in DataType, print the rows of the table
+// and append the JSON records to @results.
+template<class DataType>
+void run(const Scenario& scenario,
+         const std::vector<std::pair<Rect<double>, Rect<double> > >& rects,
+         const Options& options, std::ostringstream& results, bool& first) {
+  const std::size_t pairs = rects.size();
+  Pairs<DataType> data(pairs);
+  for (std::size_t i = 0; i < pairs; ++i)
+    data.set(i, rects[i].first, rects[i].second);
+  auto lhs = data.lhs(), rhs = data.rhs();
+
+  // The reference of the sampled pairs, see the usage.
+  const std::size_t sample = std::min(options.sample, pairs);
+  std::vector<long double> reference(sample);
+  for (std::size_t j = 0; j < sample; ++j) {
+    auto a = data.lhs(j * pairs / sample), b = data.rhs(j * pairs / sample);
+    reference[j] = detail::_box_transform(
+      Box<long double>(a.x1(), a.x2(), a.y1(), a.y2(), 0, 0),
+      Box<long double>(b.x1(), b.x2(), b.y1(), b.y2(), 0, 0));
+  }
+
+  std::vector<DataType> scalar(pairs), batch(pairs);
+  volatile DataType sink = 0;
+  const std::tuple<std::string, std::function<void()>,
+                   const std::vector<DataType>&> kernels[] = {
+    { "scalar", [&] {
+        for (std::size_t i = 0; i < pairs; ++i)
+          scalar[i] = expected_dist(data.lhs(i), data.rhs(i));
+        sink = sink + scalar[0];
+      }, scalar },
+    { "batch", [&] {
+        expected_dist(lhs, rhs, std::span<DataType>(batch));
+        sink = sink + batch[0];
+      }, batch }
+  };
+  for (const auto& [ kernel, pass, result ] : kernels) {
+    Timing t = measure(pass, pairs, options.warmup, options.reps);
+    double error = 0;
+    for (std::size_t j = 0; j < sample; ++j) {
+      long double value = result[j * pairs / sample];
+      error = std::max(error, static_cast<double>(
+        std::fabs(value - reference[j]) / reference[j]));
+    }
+    std::cout << std::left << std::setw(14) << scenario.name
+              << std::setw(11) << scenario.branch << std::setw(13)
+              << type_name<DataType> << std::setw(8) << kernel
+              << std::right << std::fixed << std::setprecision(2)
+              << std::setw(10) << t.mean << std::setw(9) << t.stddev
+              << std::setw(11) << t.rate_mean / 1e6
+              << std::scientific << std::setprecision(1)
+              << std::setw(11) << error << std::endl;
+    results << (first ? "" : ",") << "\n    { \"scenario\": \""
+            << scenario.name << "\", \"branch\": \"" << scenario.branch
+            << "\", \"precision\": \"" << type_name<DataType>
+            << "\", \"kernel\": \"" << kernel << "\",\n"
+            << std::setprecision(4) << std::scientific
+            << "      \"ns_per_pair\": { \"mean\": " << t.mean
+            << ", \"stddev\": " << t.stddev << ", \"min\": " << t.min
+            << " },\n      \"pairs_per_second\": { \"mean\": "
+            << t.rate_mean << ", \"stddev\": " << t.rate_stddev
+            << " },\n      \"max_relative_error\": " << error << " }";
+    std::cout.unsetf(std::ios::floatfield);
+    first = false;
+  }
+}
+
+// Print the usage to @out, see the top of this file.
+void usage(std::ostream& out) {
+  out << "usage: edist_bench [--pairs N] [--warmup W] [--reps R] "
+         "[--json PATH]\n"
+         "  --pairs N    pairs per scenario (default 65536, at most 2^24)\n"
+         "  --warmup W   untimed passes per kernel (default 2)\n"
+         "  --reps R     timed passes per kernel (default 10)\n"
+         "  --json PATH  write the results as JSON, \"-\" for stdout\n";
+}
+
+// Parse a non-negative integer, rejecting signs, trailing characters and
+// values out of range.
+auto parse(const std::string& value, std::size_t& result) -> bool {
+  const char* last = value.data() + value.size();
+  auto [ ptr, ec ] = std::from_chars(value.data(), last, result);
+  return ec == std::errc() && ptr == last;
+}
+
+} // namespace
+
+auto main(int argc, char* argv[]) -> int {
+  Options options;
+  std::string json;
+  for (int i = 1; i < argc; i += 2) {
+    std::string flag = argv[i];
+    if (flag == "--help" || flag == "-h") {
+      usage(std::cout);
+      return 0;
+    }
+    if (i + 1 == argc) {
+      std::cerr << "missing value of option " << flag << std::endl;
+      usage(std::cerr);
+      return 1;
+    }
+    std::string value = argv[i + 1];
+    std::size_t* count = flag == "--pairs"? &options.pairs
+                       : flag == "--warmup"? &options.warmup
+                       : flag == "--reps"? &options.reps : nullptr;
+    if (count && (!parse(value, *count)
+                  || options.pairs > Options::max_pairs)) {
+      std::cerr << "invalid value " << value << " of option " << flag
+                << std::endl;
+      usage(std::cerr);
+      return 1;
+    }
+    if (flag == "--json") json = value;
+    else if (!count) {
+      std::cerr << "unknown option " << flag << std::endl;
+      usage(std::cerr);
+      return 1;
+    }
+  }
+  options.pairs = std::max<std::size_t>(options.pairs, 1);
+  options.reps = std::max<std::size_t>(options.reps, 1);
+
+  std::ostringstream results;
+  std::cout << std::left << std::setw(14) << "scenario" << std::setw(11)
+            << "branch" << std::setw(13) << "precision" << std::setw(8)
+            << "kernel" << std::right << std::setw(10) << "ns/pair"
+            << std::setw(9) << "+-" << std::setw(11) << "Mpairs/s"
+            << std::setw(11) << "max error" << std::endl;
+  std::mt19937_64 gen(42);
+  bool first = true;
+  for (const auto& scenario : scenarios()) {
+    std::vector<std::pair<Rect<double>, Rect<double> > > rects;
+    for (std::size_t i = 0; i < options.pairs; ++i)
+      rects.push_back(scenario.generate(gen));
+    run<float>(scenario, rects, options, results, first);
+    run<double>(scenario, rects, options, results, first);
+    run<long double>(scenario, rects, options, results, first);
+  }
+
+  if (json.empty()) return 0;
+  std::ostringstream doc;
+  doc << "{\n  \"benchmark\": \"expected_dist\",\n"
+      << "  \"compiler\": \"" << __VERSION__ << "\",\n"
+      << "  \"simd_width\": { \"float\": " << simd::native_t<float>::size()
+      << ", \"double\": " << simd::native_t<double>::size() << " },\n"
+      << "  \"pairs\": " << options.pairs << ",\n  \"warmup\": "
+      << options.warmup << ",\n  \"repetitions\": " << options.reps
+      << ",\n  \"sample\": " << options.sample << ",\n  \"results\": ["
+      << results.str() << "\n  ]\n}\n";
+  if (json == "-") std::cout << doc.str();
+  else if (!(std::ofstream(json) << doc.str()).flush()) {
+    std::cerr << "cannot write " << json << std::endl;
+    return 1;
+  }
+  return 0;
+}
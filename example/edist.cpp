@@ -3,8 +3,10 @@
 #include <cmath>
 #include <chrono>
 #include <array>
+#include <vector>
 #include "rect.hpp"
 #include "expected_dist.hpp"
+#include "expected_dist_batch.hpp"
 using namespace fiocca;
 
 auto main() -> int {
@@ -13,8 +15,8 @@ auto main() -> int {
   for (int i = 0; i < repeat; ++i) {
     double x1, x2, x3, x4, y1, y2, y3, y4;
     std::cin >> x1 >> x2 >> y1 >> y2 >> x3 >> x4 >> y3 >> y4;
-    Rect<double> rect1(x1, y1, x2, y2);
-    Rect<double> rect2(x3, y3, x4, y4);
+    Rect<double> rect1(x1, x2, y1, y2);
+    Rect<double> rect2(x3, x4, y3, y4);
     auto t1 = std::chrono::steady_clock::now();
     for (int j = 0; j < 1; ++j) expected_dist(rect1, rect2);
     auto t2 = std::chrono::steady_clock::now();
@@ -22,8 +24,54 @@ auto main() -> int {
               << std::chrono::duration<double, std::milli>(t2 - t1).count()
               << "ms:\t" << std::setprecision(52)
               << expected_dist(rect1, rect2) << std::endl;
+    auto [ mean, var ] = expected_dist_var(rect1, rect2);
+    std::cout << std::setprecision(17) << "moments:\t" << mean
+              << " +/- " << std::sqrt(var) << ", E[d^2] = "
+              << expected_sqdist(rect1, rect2) << ", E[1/d] = "
+              << expected_invdist(rect1, rect2) << std::endl;
+    if (separation_ratio(rect1, rect2) < 1) {
+      auto [ approx, bound ] = expected_dist_far(rect1, rect2);
+      std::cout << "far-field:\t" << approx << " +/- "
+                << std::setprecision(3) << bound << std::endl;
+    }
   }
 
+  // Perpendicular unit segments whose ends meet up to rounding, at
+  // 0.3 - (0.1 + 0.2) = -5.55e-17. The logarithms of the primitives used to
+  // cancel to log(0) here and gave infinities instead of the value of the
+  // exact corner, (sqrt(2) + asinh(1)) / 3.
+  const double eps = 0.3 - (0.1 + 0.2);
+  const double corner = (std::sqrt(2.0) + std::asinh(1.0)) / 3;
+  const std::vector<std::pair<Rect<double>, Rect<double> > > segments {
+    { { 0, 1, 0, 0 }, { eps, eps, -1, 0 } },
+    { { 0, 1, eps, eps }, { 0, 0, 0, 1 } },
+    { { 0, 1, 0, 0 }, { 0, 0, eps, 1 + eps } },
+    { { 0, 1, 0, 0 }, { 0, 0, -eps, 1 - eps } }
+  };
+  std::array<std::vector<double>, 8> columns;
+  for (const auto& [ a, b ] : segments)
+    for (std::size_t k = 0; k != 8; ++k) {
+      const auto& rect = k < 4? a : b;
+      const double coords[] = { rect.x1(), rect.x2(), rect.y1(), rect.y2() };
+      columns[k].push_back(coords[k % 4]);
+    }
+  std::vector<double> batch(segments.size());
+  expected_dist(RectSpan<double> { columns[0], columns[1],
+                                   columns[2], columns[3] },
+                RectSpan<double> { columns[4], columns[5],
+                                   columns[6], columns[7] },
+                std::span(batch));
+  double deviation = 0;
+  for (std::size_t i = 0; i != segments.size(); ++i) {
+    auto [ a, b ] = segments[i];
+    deviation = std::max({ deviation,
+                           std::fabs(expected_dist(a, b) - corner),
+                           std::fabs(batch[i] - corner) });
+  }
+  std::cout << std::setprecision(3) << "meeting segments: max deviation "
+            << deviation << " from " << std::setprecision(17) << corner
+            << std::endl;
+
   std::cout << std::setprecision(6);
   Rect rect(0.2, 0.3, 5.6, 5.8);
   Point2d p { 2.2, 6.3 };
@@ -0,0 +1,100 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "rect.hpp"
+#include "box.hpp"
+#include "expected_dist.hpp"
+#include "expected_dist_box.hpp"
+#include "expected_dist_batch.hpp"
+#include "expected_dist_adaptive.hpp"
+using namespace fiocca;
+
+auto main(int argc, char* argv[]) -> int {
+  std::size_t size = argc > 1 ? std::stoul(argv[1]) : 1000000;
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  auto seconds = [](auto duration) {
+    return std::chrono::duration<double>(duration).count();
+  };
+
+  // Two sets of random pairs: the typical one of the batch example, and
+  // the hard one with sizes over seven decades and small offsets, where
+  // the closed representation cancels.
+  for (bool hard : { false, true }) {
+    std::vector<double> buffer(size * 8);
+    for (std::size_t i = 0; i < size; ++i) {
+      double* c = buffer.data() + i;
+      for (std::size_t k = 0; k < 8; k += 2) {
+        double lo = hard ? (unit(gen) - 0.5) * (k < 4 ? 0 : 4)
+                         : unit(gen) * 20 - 10;
+        double len = hard ? std::pow(10.0, -7 * unit(gen))
+                          : unit(gen) * 20 - 10 - lo;
+        c[k * size] = lo, c[(k + 1) * size] = lo + len;
+      }
+    }
+    auto column = [&](std::size_t k) {
+      return std::span<const double>(buffer).subspan(k * size, size);
+    };
+    RectSpan<double> lhs { column(0), column(1), column(2), column(3) };
+    RectSpan<double> rhs { column(4), column(5), column(6), column(7) };
+
+    std::vector<double> plain(size), result(size), error(size);
+    auto t1 = std::chrono::steady_clock::now();
+    expected_dist(lhs, rhs, std::span<double>(plain));
+    auto t2 = std::chrono::steady_clock::now();
+    std::size_t reruns = expected_dist_adaptive(
+      lhs, rhs, std::span<double>(result), std::span<double>(error));
+    auto t3 = std::chrono::steady_clock::now();
+
+    // Check a sample against the extended-precision reference, i.e. the
+    // Gaussian transform without the far-field shortcut.
+    double plain_error = 0, adaptive_error = 0, underestimated = 0;
+    const std::size_t checked = std::min<std::size_t>(size, 20000);
+    for (std::size_t i = 0; i < checked; ++i) {
+      long double exact = detail::_box_transform(
+        Box<long double>(lhs.x1[i], lhs.x2[i], lhs.y1[i], lhs.y2[i], 0, 0),
+        Box<long double>(rhs.x1[i], rhs.x2[i], rhs.y1[i], rhs.y2[i], 0, 0));
+      double p = std::fabs(plain[i] - exact) / exact;
+      double a = std::fabs(result[i] - exact) / exact;
+      plain_error = std::max(plain_error, p);
+      adaptive_error = std::max(adaptive_error, a);
+      underestimated += std::fabs(result[i] - exact) > error[i];
+    }
+    std::cout << std::setprecision(4) << (hard ? "hard" : "typical")
+              << " pairs:\n  plain: " << seconds(t2 - t1) * 1e9 / size
+              << "ns/pair, max relative error " << plain_error
+              << "\n  adaptive: " << seconds(t3 - t2) * 1e9 / size
+              << "ns/pair, max relative error " << adaptive_error
+              << ", " << reruns << " reruns, " << underestimated << "/"
+              << checked << " errors above the estimates" << std::endl;
+  }
+
+  // Distant pairs around the far-field threshold of long double, where the
+  // truncation error of the series dominates the rounding errors, and the
+  // estimates have to cover it.
+  std::uniform_real_distribution<double> side(0.1, 1.0), ratio(0.02, 0.04);
+  double far_error = 0, far_underestimated = 0;
+  const std::size_t nfar = 2000;
+  for (std::size_t i = 0; i < nfar; ++i) {
+    double w1 = side(gen), h1 = side(gen), w2 = side(gen), h2 = side(gen);
+    double angle = 6.283185307179586 * unit(gen);
+    double offset = std::hypot(w1 + w2, h1 + h2) / ratio(gen) / 2;
+    double cx = offset * std::cos(angle), cy = offset * std::sin(angle);
+    Rect<double> a(0, w1, 0, h1);
+    Rect<double> b(cx, cx + w2, cy, cy + h2);
+    auto [ value, error ] = expected_dist_adaptive(a, b);
+    long double exact = detail::_box_transform(
+      Box<long double>(a.x1(), a.x2(), a.y1(), a.y2(), 0, 0),
+      Box<long double>(b.x1(), b.x2(), b.y1(), b.y2(), 0, 0));
+    far_error = std::max(far_error,
+                         static_cast<double>(std::fabs(value - exact) / exact));
+    far_underestimated += std::fabs(value - exact) > error;
+  }
+  std::cout << "distant pairs: max relative error " << far_error << ", "
+            << far_underestimated << "/" << nfar
+            << " errors above the estimates" << std::endl;
+  return 0;
+}
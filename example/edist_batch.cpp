@@ -0,0 +1,143 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "rect.hpp"
+#include "expected_dist.hpp"
+#include "expected_dist_batch.hpp"
+#include "expected_dist_dispatch.hpp"
+#include "expected_dist_matrix.hpp"
+using namespace fiocca;
+
+auto main(int argc, char* argv[]) -> int {
+  std::size_t size = argc > 1 ? std::stoul(argv[1]) : 1000000;
+
+  // Generate random pairs of rectangles. Some of them are degenerated to
+  // lines or points to cover all cases of the closed representation.
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> coord(-10.0, 10.0);
+  std::bernoulli_distribution degenerate(0.05);
+  std::vector<double> buffer(size * 8);
+  for (std::size_t i = 0; i < size * 8; i += 2) {
+    buffer[i] = coord(gen);
+    buffer[i + 1] = degenerate(gen) ? buffer[i] : coord(gen);
+  }
+  auto column = [&](std::size_t k) {
+    return std::span<const double>(buffer).subspan(k * size, size);
+  };
+  RectSpan<double> lhs { column(0), column(1), column(2), column(3) };
+  RectSpan<double> rhs { column(4), column(5), column(6), column(7) };
+
+  // The scalar loop.
+  std::vector<double> scalar(size), batch(size);
+  auto t1 = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < size; ++i)
+    scalar[i] = expected_dist(
+      Rect<double>(lhs.x1[i], lhs.x2[i], lhs.y1[i], lhs.y2[i]),
+      Rect<double>(rhs.x1[i], rhs.x2[i], rhs.y1[i], rhs.y2[i]));
+  auto t2 = std::chrono::steady_clock::now();
+
+  // The batched simd kernel, compiled for the instruction set of this
+  // program, and the one of libfiocca selected for the host.
+  expected_dist(lhs, rhs, std::span<double>(batch));
+  auto t3 = std::chrono::steady_clock::now();
+  std::vector<double> dispatched(size);
+  dispatch::expected_dist(lhs, rhs, std::span<double>(dispatched));
+  auto t8 = std::chrono::steady_clock::now();
+
+  // The dispatched kernels may contract into fused multiply-adds, which
+  // round differently where the closed representation cancels.
+  double max_error = 0, max_deviation = 0;
+  for (std::size_t i = 0; i < size; ++i) {
+    double scale = std::max(1.0, std::fabs(scalar[i]));
+    max_error = std::max(max_error, std::fabs(batch[i] - scalar[i]) / scale);
+    max_deviation = std::max(max_deviation,
+                             std::fabs(dispatched[i] - scalar[i]) / scale);
+  }
+
+  auto throughput = [&](auto duration) {
+    return size / std::chrono::duration<double>(duration).count();
+  };
+  std::cout << std::setprecision(4)
+            << "scalar: " << throughput(t2 - t1) << " pairs/s\n"
+            << "batch:  " << throughput(t3 - t2) << " pairs/s ("
+            << TwinRectSimd<double>::size() << " lanes)\n"
+            << "dispatched: " << throughput(t8 - t3) << " pairs/s ("
+            << dispatch::isa_name(dispatch::active_isa())
+            << "), max deviation: " << max_deviation << "\n"
+            << "max relative error: " << max_error << std::endl;
+
+  // The float kernels against a long double reference, which must stay
+  // within the tolerance of the closed representation for every
+  // instruction set, see promotion_tolerance.
+  std::vector<float> fbuffer(buffer.begin(), buffer.end());
+  auto fcolumn = [&](std::size_t k) {
+    return std::span<const float>(fbuffer).subspan(k * size, size);
+  };
+  RectSpan<float> flhs { fcolumn(0), fcolumn(1), fcolumn(2), fcolumn(3) };
+  RectSpan<float> frhs { fcolumn(4), fcolumn(5), fcolumn(6), fcolumn(7) };
+  std::vector<float> fbatch(size), fdispatched(size);
+  expected_dist(flhs, frhs, std::span<float>(fbatch));
+  dispatch::expected_dist(flhs, frhs, std::span<float>(fdispatched));
+  double float_error = 0, float_deviation = 0;
+  for (std::size_t i = 0; i < size; ++i) {
+    long double expected = expected_dist(
+      Rect<long double>(flhs.x1[i], flhs.x2[i], flhs.y1[i], flhs.y2[i]),
+      Rect<long double>(frhs.x1[i], frhs.x2[i], frhs.y1[i], frhs.y2[i]));
+    long double scale = std::max(1.0L, std::fabs(expected));
+    float_error = std::max<double>(float_error,
+                                   std::fabs(fbatch[i] - expected) / scale);
+    float_deviation = std::max<double>(
+      float_deviation, std::fabs(fdispatched[i] - expected) / scale);
+  }
+  std::cout << "float: max relative error " << float_error
+            << ", dispatched " << float_deviation << " (tolerance "
+            << promotion_tolerance<float> << ")" << std::endl;
+
+  // The all-pairs matrix of the lefthand side rectangles.
+  std::size_t n = std::min<std::size_t>(size, 2000);
+  std::vector<Rect<double> > rects;
+  for (std::size_t i = 0; i < n; ++i)
+    rects.emplace_back(lhs.x1[i], lhs.x2[i], lhs.y1[i], lhs.y2[i]);
+  DistMatrix<double> engine(rects);
+  std::vector<double> dense(n * n), packed(engine.packed_size(n));
+  auto t4 = std::chrono::steady_clock::now();
+  engine.dense(dense);
+  auto t5 = std::chrono::steady_clock::now();
+  engine.packed(packed);
+
+  max_error = 0;
+  for (std::size_t i = 0; i < n; i += 97)
+    for (std::size_t j = 0; j < n; j += 89) {
+      double expected = expected_dist(rects[i], rects[j]);
+      max_error = std::max({ max_error,
+        std::fabs(dense[i * n + j] - expected) / std::max(1.0, expected),
+        std::fabs(packed[engine.packed_index(i, j)] - expected)
+          / std::max(1.0, expected) });
+    }
+  std::cout << "matrix: " << n << "x" << n << " in "
+            << std::chrono::duration<double, std::milli>(t5 - t4).count()
+            << "ms, max relative error: " << max_error << std::endl;
+
+  // Many points against one rectangle.
+  std::size_t npoints = 10 * size;
+  std::vector<double> px(npoints), py(npoints), dist(npoints);
+  for (std::size_t i = 0; i < npoints; ++i)
+    px[i] = coord(gen), py[i] = coord(gen);
+  Rect<double> zone(-2.0, 3.0, 1.0, 5.0);
+  auto t6 = std::chrono::steady_clock::now();
+  expected_dist(PointSpan<double> { px, py }, zone, std::span<double>(dist));
+  auto t7 = std::chrono::steady_clock::now();
+
+  max_error = 0;
+  for (std::size_t i = 0; i < npoints; i += 101) {
+    double expected = expected_dist(Point2d { px[i], py[i] }, zone);
+    max_error = std::max(max_error, std::fabs(dist[i] - expected) / expected);
+  }
+  std::cout << "points: " << npoints / std::chrono::duration<double>(
+              t7 - t6).count() << " points/s, max relative error: "
+            << max_error << std::endl;
+  return 0;
+}
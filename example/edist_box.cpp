@@ -0,0 +1,96 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include "rect.hpp"
+#include "box.hpp"
+#include "expected_dist.hpp"
+#include "expected_dist_box.hpp"
+using namespace fiocca;
+
+auto main(int argc, char* argv[]) -> int {
+  std::size_t samples = argc > 1 ? std::stoul(argv[1]) : 1000000;
+  auto ms = [](auto duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  };
+
+  // The plain Monte Carlo estimate over the six coordinates, and its
+  // standard error.
+  std::mt19937_64 gen(42);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  auto monte_carlo = [&](const Box<double>& a, const Box<double>& b) {
+    auto [ w1, h1, d1 ] = a.shape();
+    auto [ w2, h2, d2 ] = b.shape();
+    double sum = 0, sq = 0;
+    for (std::size_t i = 0; i < samples; ++i) {
+      double dx = b.x1() + w2 * unit(gen) - a.x1() - w1 * unit(gen);
+      double dy = b.y1() + h2 * unit(gen) - a.y1() - h1 * unit(gen);
+      double dz = b.z1() + d2 * unit(gen) - a.z1() - d1 * unit(gen);
+      double r = std::sqrt(dx * dx + dy * dy + dz * dz);
+      sum += r, sq += r * r;
+    }
+    double mean = sum / samples;
+    return std::make_pair(mean, std::sqrt((sq / samples - mean * mean)
+                                          / samples));
+  };
+
+  // The unit cube has the known mean distance 0.66170718226717623515...
+  std::cout << std::setprecision(16) << "unit cube: "
+            << expected_dist(Box<double>(0, 1, 0, 1, 0, 1),
+                             Box<double>(0, 1, 0, 1, 0, 1))
+            << " (0.6617071822671762)" << std::endl;
+
+  // Flat boxes in the same plane reduce to rectangles.
+  Rect<double> r1(0.0, 2.0, 0.0, 1.0), r2(1.5, 2.5, 0.5, 3.0);
+  std::cout << "flat boxes: "
+            << expected_dist(Box<double>(0.0, 2.0, 0.0, 1.0, 1.0, 1.0),
+                             Box<double>(1.5, 2.5, 0.5, 3.0, 1.0, 1.0))
+            << ", rectangles: " << expected_dist(r1, r2) << std::endl;
+
+  const std::vector<std::pair<Box<double>, Box<double> > > cases {
+    { { 0, 1, 0, 1, 0, 1 }, { 0, 1, 0, 1, 0, 1 } },
+    { { 0, 1, 0, 2, 0, 3 }, { 0.5, 1.5, 1, 2, 2, 2.5 } },
+    { { 0, 4, 0, 0.1, 0, 0.1 }, { 1, 1.1, -2, 2, 0, 0.1 } },
+    { { 0, 1, 0, 1, 0, 0 }, { 3, 4, 1, 2, 2, 5 } },
+    { { 0, 1, 0, 1, 0, 1 }, { 30, 31, 20, 22, 10, 10.5 } }
+  };
+  std::cout << std::setprecision(8)
+            << "samples of Monte Carlo: " << samples << std::endl;
+  for (const auto& [ a, b ] : cases) {
+    auto t1 = std::chrono::steady_clock::now();
+    double exact = 0;
+    for (int k = 0; k < 1000; ++k) exact += expected_dist(a, b);
+    exact /= 1000;
+    auto t2 = std::chrono::steady_clock::now();
+    auto [ mean, error ] = monte_carlo(a, b);
+    auto t3 = std::chrono::steady_clock::now();
+    std::cout << "quadrature: " << exact << " in "
+              << ms(t2 - t1) << "us, Monte Carlo: " << mean
+              << " +- " << error << " in " << ms(t3 - t2) << "ms, "
+              << "deviation: " << (mean - exact) / error << " sigma"
+              << std::endl;
+  }
+
+  // The batch of random pairs.
+  const std::size_t size = 100000;
+  std::uniform_real_distribution<double> coord(0.0, 100.0);
+  std::lognormal_distribution<double> side(1.0, 1.0);
+  auto random_box = [&] {
+    double x = coord(gen), y = coord(gen), z = coord(gen);
+    return Box<double>(x, x + side(gen), y, y + side(gen), z, z + side(gen));
+  };
+  std::vector<Box<double> > lhs(size), rhs(size);
+  std::ranges::generate(lhs, random_box);
+  std::ranges::generate(rhs, random_box);
+  std::vector<double> result(size);
+  auto t1 = std::chrono::steady_clock::now();
+  expected_dist(std::span<const Box<double> >(lhs),
+                std::span<const Box<double> >(rhs), std::span(result));
+  auto t2 = std::chrono::steady_clock::now();
+  std::cout << "batch: " << ms(t2 - t1) << "ms for " << size << " pairs"
+            << std::endl;
+  return 0;
+}
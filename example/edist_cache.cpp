@@ -0,0 +1,53 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <chrono>
+#include <vector>
+#include "rect.hpp"
+#include "expected_dist.hpp"
+#include "expected_dist_cache.hpp"
+using namespace fiocca;
+
+auto main() -> int {
+  // A layout of standard cells on a regular grid. There are only a few
+  // distinct cell shapes, so most pairs share their normalized shapes.
+  const double shapes[][2] = { { 1.0, 1.0 }, { 2.0, 1.0 }, { 1.0, 3.0 } };
+  std::vector<Rect<double> > cells;
+  for (int i = 0; i < 24; ++i)
+    for (int j = 0; j < 24; ++j) {
+      auto [ w, h ] = shapes[(i * 7 + j * 3) % 3];
+      cells.emplace_back(i * 4.0, i * 4.0 + w, j * 4.0, j * 4.0 + h);
+    }
+
+  double plain = 0, cached = 0;
+  auto t1 = std::chrono::steady_clock::now();
+  for (const auto& lhs : cells)
+    for (const auto& rhs : cells)
+      plain += expected_dist(lhs, rhs);
+  auto t2 = std::chrono::steady_clock::now();
+
+  DistCache<double> cache(1 << 14);
+  for (const auto& lhs : cells)
+    for (const auto& rhs : cells)
+      cached += expected_dist(lhs, rhs, cache);
+  auto t3 = std::chrono::steady_clock::now();
+
+  // Quantized shapes with a coarse resolution.
+  DistCache<double> coarse(1 << 14, CachePolicy::quantized, 0.5);
+  double approx = 0;
+  for (const auto& lhs : cells)
+    for (const auto& rhs : cells)
+      approx += expected_dist(lhs, rhs, coarse);
+
+  std::cout << std::setprecision(10)
+            << "plain:  " << plain << " in "
+            << std::chrono::duration<double, std::milli>(t2 - t1).count()
+            << "ms\n"
+            << "cached: " << cached << " in "
+            << std::chrono::duration<double, std::milli>(t3 - t2).count()
+            << "ms (" << cache.hits() << " hits, " << cache.misses()
+            << " misses, " << cache.size() << " entries)\n"
+            << "quantized: " << approx << " (" << coarse.hits() << " hits, "
+            << coarse.misses() << " misses)" << std::endl;
+  return 0;
+}
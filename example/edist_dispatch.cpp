@@ -0,0 +1,74 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "rect.hpp"
+#include "expected_dist.hpp"
+#include "expected_dist_batch.hpp"
+#include "expected_dist_dispatch.hpp"
+using namespace fiocca;
+
+auto main(int argc, char* argv[]) -> int {
+  std::size_t size = argc > 1 ? std::stoul(argv[1]) : 1000000;
+  std::cout << "active: " << dispatch::isa_name(dispatch::active_isa())
+            << std::endl;
+
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> coord(-10.0, 10.0);
+  std::vector<double> buffer(size * 8);
+  for (auto& value : buffer) value = coord(gen);
+  std::vector<float> fbuffer(buffer.begin(), buffer.end());
+  auto spans = [&](const auto& data) {
+    using value_type = typename std::decay_t<decltype(data)>::value_type;
+    auto column = [&](std::size_t k) {
+      return std::span<const value_type>(data).subspan(k * size, size);
+    };
+    return std::make_pair(
+      RectSpan<value_type> { column(0), column(1), column(2), column(3) },
+      RectSpan<value_type> { column(4), column(5), column(6), column(7) });
+  };
+  auto [ lhs, rhs ] = spans(buffer);
+  auto [ flhs, frhs ] = spans(fbuffer);
+
+  // The header-only kernels compiled for the baseline of this program.
+  std::vector<double> header(size), result(size);
+  std::vector<float> fheader(size), fresult(size);
+  auto ns = [&](auto&& run) {
+    auto t1 = std::chrono::steady_clock::now();
+    run();
+    auto t2 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(t2 - t1).count() / size;
+  };
+  std::cout << std::setprecision(4) << "header-only: "
+            << ns([&] { expected_dist(lhs, rhs, std::span(header)); })
+            << "ns/pair (double), "
+            << ns([&] { expected_dist(flhs, frhs, std::span(fheader)); })
+            << "ns/pair (float)" << std::endl;
+
+  for (auto isa : { dispatch::Isa::generic, dispatch::Isa::sse2,
+                    dispatch::Isa::avx2, dispatch::Isa::avx512 }) {
+    if (!dispatch::select_isa(isa)) continue;
+    double time = ns([&] {
+      dispatch::expected_dist(lhs, rhs, std::span(result));
+    });
+    double ftime = ns([&] {
+      dispatch::expected_dist(flhs, frhs, std::span(fresult));
+    });
+    double error = 0, ferror = 0;
+    for (std::size_t i = 0; i < size; ++i) {
+      error = std::max(error, std::fabs(result[i] - header[i]) / header[i]);
+      ferror = std::max(ferror, double(std::fabs(fresult[i] - fheader[i])
+                                       / fheader[i]));
+    }
+    double integral = dispatch::romberg(
+      [](double x) { return std::exp(-x * x); }, 0.0, 2.0);
+    std::cout << dispatch::isa_name(isa) << ": " << time
+              << "ns/pair (double), " << ftime << "ns/pair (float), "
+              << "max deviations " << error << " and " << ferror
+              << ", romberg " << std::setprecision(12) << integral
+              << std::setprecision(4) << std::endl;
+  }
+  return 0;
+}
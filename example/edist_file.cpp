@@ -0,0 +1,60 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include "rect.hpp"
+#include "expected_dist.hpp"
+#include "expected_dist_batch.hpp"
+#include "expected_dist_file.hpp"
+using namespace fiocca;
+
+// Runs the round trip through temporary files of random pairs, see the
+// edist_file tool for evaluating existing files.
+auto main(int argc, char* argv[]) -> int {
+  auto seconds = [](auto duration) {
+    return std::chrono::duration<double>(duration).count();
+  };
+  std::size_t size = argc > 1 ? std::stoul(argv[1]) : 2000000;
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> coord(-10.0, 10.0);
+  std::vector<double> buffer(size * 8);
+  for (auto& value : buffer) value = coord(gen);
+  auto column = [&](std::size_t k) {
+    return std::span<const double>(buffer).subspan(k * size, size);
+  };
+  RectSpan<double> lhs { column(0), column(1), column(2), column(3) };
+  RectSpan<double> rhs { column(4), column(5), column(6), column(7) };
+
+  auto dir = std::filesystem::temp_directory_path();
+  std::string input = dir / "fiocca_pairs.bin";
+  std::string output = dir / "fiocca_dists.bin";
+  write_pairs_file(input, lhs, rhs);
+
+  // Several windows are streamed through, compared with the batch kernel
+  // in memory.
+  auto t1 = std::chrono::steady_clock::now();
+  expected_dist_file(input, output, size / 7 + 1);
+  auto t2 = std::chrono::steady_clock::now();
+  std::vector<double> batch(size), mapped(size);
+  expected_dist(lhs, rhs, std::span<double>(batch));
+  auto t3 = std::chrono::steady_clock::now();
+
+  std::ifstream file(output, std::ios::binary);
+  BatchHeader header;
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  file.read(reinterpret_cast<char*>(mapped.data()), size * sizeof(double));
+  std::size_t mismatches = 0;
+  for (std::size_t i = 0; i < size; ++i) mismatches += mapped[i] != batch[i];
+  std::cout << std::setprecision(4) << "file: " << header.count
+            << " pairs in " << seconds(t2 - t1) << "s, memory: "
+            << seconds(t3 - t2) << "s, mismatches: " << mismatches
+            << std::endl;
+  std::filesystem::remove(input);
+  std::filesystem::remove(output);
+  return 0;
+}
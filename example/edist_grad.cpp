@@ -0,0 +1,86 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "rect.hpp"
+#include "expected_dist.hpp"
+#include "expected_dist_grad.hpp"
+using namespace fiocca;
+
+auto main(int argc, char* argv[]) -> int {
+  std::size_t size = argc > 1 ? std::stoul(argv[1]) : 2000;
+
+  // A random placement of blocks connected by random nets.
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> coord(0.0, 100.0), side(0.5, 5.0);
+  std::uniform_int_distribution<std::size_t> pick(0, size - 1);
+  std::vector<Rect<double> > rects;
+  for (std::size_t i = 0; i < size; ++i) {
+    double x = coord(gen), y = coord(gen);
+    rects.emplace_back(x, x + side(gen), y, y + side(gen));
+  }
+  std::vector<std::pair<std::size_t, std::size_t> > edges;
+  std::vector<double> weights;
+  for (std::size_t e = 0; e < 10 * size; ++e) {
+    std::size_t i = pick(gen), j = pick(gen);
+    if (i != j) edges.emplace_back(i, j), weights.push_back(side(gen));
+  }
+
+  // The analytic gradient of the objective.
+  std::vector<std::array<double, 4> > grad(size);
+  auto t1 = std::chrono::steady_clock::now();
+  double objective = expected_dist_grad<double>(rects, edges, weights, grad);
+  auto t2 = std::chrono::steady_clock::now();
+
+  // The central differences, i.e. 16 extra evaluations per edge. The step
+  // balances the truncation error and the rounding of the closed form.
+  const double step = 1e-3;
+  std::vector<std::array<double, 4> > diff(size);
+  auto shifted = [&](const Rect<double>& rect, std::size_t k, double d) {
+    double c[] = { rect.x1(), rect.x2(), rect.y1(), rect.y2() };
+    c[k] += d;
+    return Rect<double>(c[0], c[1], c[2], c[3]);
+  };
+  for (std::size_t e = 0; e < edges.size(); ++e) {
+    const auto& a = rects[edges[e].first];
+    const auto& b = rects[edges[e].second];
+    for (std::size_t k = 0; k != 4; ++k) {
+      diff[edges[e].first][k] += weights[e] / (2 * step)
+          * (expected_dist(shifted(a, k, step), b)
+           - expected_dist(shifted(a, k, -step), b));
+      diff[edges[e].second][k] += weights[e] / (2 * step)
+          * (expected_dist(a, shifted(b, k, step))
+           - expected_dist(a, shifted(b, k, -step)));
+    }
+  }
+  auto t3 = std::chrono::steady_clock::now();
+  double max_error = 0;
+  for (std::size_t i = 0; i < size; ++i)
+    for (std::size_t k = 0; k != 4; ++k)
+      max_error = std::max(max_error, std::fabs(grad[i][k] - diff[i][k]));
+
+  auto ms = [](auto duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  };
+  std::cout << std::setprecision(6) << edges.size() << " edges, objective "
+            << objective << "\nanalytic: " << ms(t2 - t1)
+            << "ms, finite differences: " << ms(t3 - t2)
+            << "ms, max difference " << max_error << std::endl;
+
+  // A few steps of gradient descent on the positions, where a translation
+  // moves both coordinates of a dimension together.
+  for (int iter = 1; iter <= 5; ++iter) {
+    for (std::size_t i = 0; i < size; ++i) {
+      double dx = -0.01 * (grad[i][0] + grad[i][1]) / size;
+      double dy = -0.01 * (grad[i][2] + grad[i][3]) / size;
+      const auto& r = rects[i];
+      rects[i] = Rect<double>(r.x1() + dx, r.x2() + dx,
+                              r.y1() + dy, r.y2() + dy);
+    }
+    objective = expected_dist_grad<double>(rects, edges, weights, grad);
+    std::cout << "step " << iter << ": objective " << objective << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,62 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "rect.hpp"
+#include "expected_dist_graph.hpp"
+using namespace fiocca;
+
+auto main(int argc, char* argv[]) -> int {
+  std::size_t size = argc > 1 ? std::stoul(argv[1]) : 100000;
+
+  // A random placement of blocks, each connected to a few random blocks.
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> coord(0.0, 1000.0), side(0.5, 5.0);
+  std::uniform_int_distribution<std::size_t> pick(0, size - 1);
+  std::vector<Rect<double> > rects;
+  for (std::size_t i = 0; i < size; ++i) {
+    double x = coord(gen), y = coord(gen);
+    rects.emplace_back(x, x + side(gen), y, y + side(gen));
+  }
+  std::vector<std::pair<std::size_t, std::size_t> > edges;
+  std::vector<double> weights;
+  for (std::size_t e = 0; e < 5 * size; ++e)
+    edges.emplace_back(pick(gen), pick(gen)), weights.push_back(side(gen));
+
+  auto t1 = std::chrono::steady_clock::now();
+  DistGraph<double> graph(rects, edges, weights);
+  auto t2 = std::chrono::steady_clock::now();
+
+  // Greedy moves of single blocks towards random displacements, accepted
+  // if the objective decreases.
+  const std::size_t nmoves = 100000;
+  std::normal_distribution<double> step(0.0, 20.0);
+  std::size_t accepted = 0;
+  double initial = graph.objective();
+  auto t3 = std::chrono::steady_clock::now();
+  for (std::size_t m = 0; m < nmoves; ++m) {
+    std::size_t i = pick(gen);
+    const auto& r = graph.rects()[i];
+    double dx = step(gen), dy = step(gen);
+    if (graph.propose(i, Rect<double>(r.x1() + dx, r.x2() + dx,
+                                      r.y1() + dy, r.y2() + dy)) < 0)
+      graph.accept(), ++accepted;
+    else graph.reject();
+  }
+  auto t4 = std::chrono::steady_clock::now();
+  double incremental = graph.objective();
+  double exact = graph.recompute();
+
+  auto ms = [](auto duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  };
+  std::cout << std::setprecision(10) << size << " blocks, " << edges.size()
+            << " edges\nfull evaluation: " << ms(t2 - t1) << "ms\n"
+            << "incremental: " << ms(t4 - t3) * 1000 / nmoves
+            << "us/move, " << accepted << " of " << nmoves << " accepted\n"
+            << "objective: " << initial << " -> " << incremental
+            << " (recomputed " << exact << ")" << std::endl;
+  return 0;
+}
@@ -0,0 +1,63 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include "rect.hpp"
+#include "expected_dist.hpp"
+#include "expected_dist_index.hpp"
+using namespace fiocca;
+
+auto main(int argc, char* argv[]) -> int {
+  std::size_t size = argc > 1 ? std::stoul(argv[1]) : 1000000;
+  const std::size_t k = 10;
+
+  // Random zones of various sizes and aspect ratios.
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> coord(0.0, 10000.0);
+  std::lognormal_distribution<double> side(1.0, 1.0);
+  auto random_rect = [&] {
+    double x = coord(gen), y = coord(gen);
+    return Rect<double>(x, x + side(gen), y, y + side(gen));
+  };
+  std::vector<Rect<double> > zones(size);
+  std::ranges::generate(zones, random_rect);
+
+  auto t1 = std::chrono::steady_clock::now();
+  DistIndex<double> index(zones);
+  auto t2 = std::chrono::steady_clock::now();
+  std::vector<Rect<double> > queries(1000);
+  std::ranges::generate(queries, random_rect);
+  auto results = index.nearest(queries, k);
+  auto t3 = std::chrono::steady_clock::now();
+
+  // Compare a few queries with the linear scan.
+  bool match = true;
+  std::vector<std::pair<double, std::size_t> > scan(size);
+  auto t4 = std::chrono::steady_clock::now();
+  for (std::size_t q = 0; q < 5; ++q) {
+    for (std::size_t i = 0; i < size; ++i)
+      scan[i] = { expected_dist(queries[q], zones[i]), i };
+    std::partial_sort(scan.begin(), scan.begin() + k, scan.end());
+    for (std::size_t i = 0; i < k; ++i)
+      match = match && results[q][i].first == scan[i].second
+                    && results[q][i].second == scan[i].first;
+  }
+  auto t5 = std::chrono::steady_clock::now();
+
+  auto ms = [](auto duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  };
+  std::cout << std::setprecision(4)
+            << "build: " << ms(t2 - t1) << "ms for " << size << " zones\n"
+            << "indexed: " << ms(t3 - t2) / queries.size() << "ms/query\n"
+            << "linear scan: " << ms(t5 - t4) / 5 << "ms/query\n"
+            << "top-" << k << " match: " << (match ? "yes" : "no")
+            << std::endl;
+  std::cout << "nearest to the first query:";
+  for (auto [ i, dist ] : results[0]) std::cout << " " << i << ":" << dist;
+  std::cout << std::endl;
+  return 0;
+}
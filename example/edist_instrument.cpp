@@ -0,0 +1,72 @@
+// The probes are compiled in regardless of the CMake option.
+#ifndef FIOCCA_INSTRUMENT
+#define FIOCCA_INSTRUMENT
+#endif
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "rect.hpp"
+#include "instrument.hpp"
+#include "expected_dist.hpp"
+#include "numeric_integral.hpp"
+using namespace fiocca;
+
+// The instrumented paths stay evaluable at compile time.
+static constexpr double unit_square = expected_dist(
+  Rect<double>(0.0, 1.0, 0.0, 1.0), Rect<double>(0.0, 1.0, 0.0, 1.0));
+
+auto main(int argc, char* argv[]) -> int {
+  std::size_t size = argc > 1 ? std::stoul(argv[1]) : 200000;
+
+  // Random pairs, where some sides are degenerated and some pairs are far
+  // apart, so that all branches are hit.
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> coord(-10.0, 10.0);
+  std::bernoulli_distribution degenerate(0.2), far(0.1);
+  std::vector<Rect<double> > lhs, rhs;
+  for (std::size_t i = 0; i < size; ++i) {
+    double c[8];
+    for (std::size_t k = 0; k < 8; k += 2) {
+      c[k] = coord(gen) + (k >= 4 && far(gen) ? 1000 : 0);
+      c[k + 1] = degenerate(gen) ? c[k] : c[k] + coord(gen) / 5;
+    }
+    lhs.emplace_back(c[0], c[1], c[2], c[3]);
+    rhs.emplace_back(c[4], c[5], c[6], c[7]);
+  }
+
+  instrument::reset();
+  double sum = 0;
+#pragma omp parallel for reduction(+:sum)
+  for (std::size_t i = 0; i < size; ++i) sum += expected_dist(lhs[i], rhs[i]);
+  for (double accuracy : { 1e-6, 1e-9, 1e-12 })
+    sum += integral::romberg([](double x) { return std::exp(-x * x); },
+                             0.0, 2.0, accuracy);
+
+  // The median bucket of the histogram of cycles.
+  auto median = [](const instrument::ProbeStats& stats) {
+    std::uint64_t seen = 0;
+    for (std::size_t b = 0; b != instrument::buckets; ++b)
+      if ((seen += stats.histogram[b]) * 2 >= stats.calls)
+        return b? std::uint64_t(1) << (b - 1) : 0;
+    return std::uint64_t(0);
+  };
+  auto stats = instrument::snapshot();
+  std::cout << "unit square: " << unit_square << ", checksum: " << sum
+            << "\n" << std::left << std::setw(18) << "probe" << std::right
+            << std::setw(12) << "calls" << std::setw(14) << "cycles/call"
+            << std::setw(14) << "median >=" << std::setw(14)
+            << "iters/call" << std::endl;
+  for (std::size_t p = 0; p != instrument::probe_count; ++p) {
+    const auto& s = stats[p];
+    if (!s.calls) continue;
+    std::cout << std::left << std::setw(18)
+              << instrument::probe_name(instrument::Probe(p)) << std::right
+              << std::setw(12) << s.calls << std::setw(14)
+              << s.cycles / s.calls << std::setw(14) << median(s)
+              << std::setw(14) << double(s.iterations) / s.calls
+              << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,74 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <limits>
+#include <string>
+#include <vector>
+#include "rect.hpp"
+#include "expected_dist.hpp"
+#include "expected_dist_lookup.hpp"
+#include "expected_dist_adaptive.hpp"
+using namespace fiocca;
+
+auto main(int argc, char* argv[]) -> int {
+  double tolerance = argc > 1 ? std::stod(argv[1]) : 3e-3;
+  std::string path = argc > 2 ? argv[2] : "edist_lookup.bin";
+  std::size_t size = 1000000;
+
+  // Build the table once and save it, as a service would do offline.
+  auto seconds = [](auto&& run) {
+    auto t1 = std::chrono::steady_clock::now();
+    run();
+    auto t2 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(t2 - t1).count();
+  };
+  double build = seconds([&] { DistLookup<double>(tolerance).save(path); });
+  auto t1 = std::chrono::steady_clock::now();
+  auto lookup = DistLookup<double>::load(path);
+  auto t2 = std::chrono::steady_clock::now();
+  double load = std::chrono::duration<double>(t2 - t1).count();
+  std::cout << std::setprecision(4) << "built " << lookup.size()
+            << " values in " << build << "s, loaded in " << load
+            << "s, estimated error " << lookup.est_error() << std::endl;
+
+  // Random pairs of all aspect ratios, partly far apart.
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> coord(-3.0, 3.0), side(0.0, 2.0);
+  std::vector<Rect<double>> lhs, rhs;
+  for (std::size_t i = 0; i < size; ++i) {
+    double x = coord(gen), y = coord(gen);
+    lhs.emplace_back(x, x + side(gen), y, y + side(gen));
+    x = coord(gen) * (i % 10 ? 1 : 30), y = coord(gen);
+    rhs.emplace_back(x, x + side(gen), y, y + side(gen));
+  }
+  std::vector<double> exact(size), approx(size);
+  double exact_time = seconds([&] {
+    for (std::size_t i = 0; i < size; ++i)
+      exact[i] = expected_dist(lhs[i], rhs[i]);
+  });
+  double approx_time = seconds([&] {
+    for (std::size_t i = 0; i < size; ++i)
+      approx[i] = lookup(lhs[i], rhs[i]);
+  });
+  // The errors are checked against the guarded precision, since the plain
+  // closed form may itself lose digits for the thinnest rectangles.
+  double error = 0;
+  for (std::size_t i = 0; i < size; ++i) {
+    double reference = expected_dist_adaptive(lhs[i], rhs[i]).first;
+    error = std::max(error, std::fabs(approx[i] - reference) / reference);
+  }
+  std::cout << "closed form: " << exact_time / size * 1e9 << "ns/pair, "
+            << "lookup: " << approx_time / size * 1e9 << "ns/pair, "
+            << "max relative error " << error << " ("
+            << (error <= lookup.est_error() ? "within" : "ABOVE")
+            << " the estimated error)" << std::endl;
+
+  // Non-finite coordinates have no parameters in the table.
+  double inf = std::numeric_limits<double>::infinity();
+  std::cout << "infinite offset: "
+            << lookup(Rect<double>(0, 1, 0, 1), Rect<double>(inf, inf, 0, 1))
+            << std::endl;
+  return 0;
+}
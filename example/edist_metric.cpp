@@ -0,0 +1,52 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "rect.hpp"
+#include "expected_dist_metric.hpp"
+using namespace fiocca;
+
+// Evaluate a batch in a metric, and return the elapsed time in ns/pair.
+template<class Metric>
+auto run(const RectSpan<double>& lhs, const RectSpan<double>& rhs,
+         std::span<double> result, Metric metric) {
+  auto t1 = std::chrono::steady_clock::now();
+  expected_dist(lhs, rhs, result, metric);
+  auto t2 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(t2 - t1).count()
+       / lhs.size();
+}
+
+auto main() -> int {
+  // The unit square to itself, whose values are known: 2/3 in L1, about
+  // 0.5214 in L2 and 7/15 in L-infinity.
+  Rect<double> unit(0, 1, 0, 1), aisle(3, 4, 0, 10), dock(20, 30, 2, 2);
+  std::cout << std::setprecision(10);
+  for (auto [ name, rhs ] : { std::pair { "unit", unit },
+                              std::pair { "aisle", aisle },
+                              std::pair { "dock", dock } })
+    std::cout << "unit-" << name << ": L1 "
+              << expected_dist(unit, rhs, Manhattan()) << ", L2 "
+              << expected_dist(unit, rhs, Euclidean()) << ", Linf "
+              << expected_dist(unit, rhs, Chebyshev()) << std::endl;
+
+  // Random pairs of rectangles in batch.
+  const std::size_t size = 1 << 20;
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> coord(0.0, 100.0), side(0.0, 10.0);
+  std::vector<double> coords[8];
+  for (std::size_t i = 0; i < size; ++i)
+    for (std::size_t k = 0; k != 8; k += 2) {
+      double x = coord(gen);
+      coords[k].push_back(x), coords[k + 1].push_back(x + side(gen));
+    }
+  RectSpan<double> lhs { coords[0], coords[1], coords[2], coords[3] };
+  RectSpan<double> rhs { coords[4], coords[5], coords[6], coords[7] };
+  std::vector<double> result(size);
+  std::cout << std::setprecision(4) << size << " pairs: L1 "
+            << run(lhs, rhs, result, Manhattan()) << "ns/pair, L2 "
+            << run(lhs, rhs, result, Euclidean()) << "ns/pair, Linf "
+            << run(lhs, rhs, result, Chebyshev()) << "ns/pair" << std::endl;
+  return 0;
+}
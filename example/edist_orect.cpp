@@ -0,0 +1,106 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <chrono>
+#include <numbers>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include "rect.hpp"
+#include "orect.hpp"
+#include "expected_dist.hpp"
+#include "expected_dist_orect.hpp"
+using namespace fiocca;
+
+auto main(int argc, char* argv[]) -> int {
+  std::size_t samples = argc > 1 ? std::stoul(argv[1]) : 1000000;
+  constexpr double pi = std::numbers::pi;
+  auto ms = [](auto duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  };
+
+  // The plain Monte Carlo estimate over the four coordinates along the
+  // axes of the rectangles, and its standard error.
+  std::mt19937_64 gen(42);
+  std::uniform_real_distribution<double> unit(-1.0, 1.0);
+  auto monte_carlo = [&](const ORect<double>& a, const ORect<double>& b) {
+    auto [ u1, v1, u2, v2 ] = std::make_tuple(a.u(), a.v(), b.u(), b.v());
+    Point<double> d = b.center() - a.center();
+    double sum = 0, sq = 0;
+    for (std::size_t i = 0; i < samples; ++i) {
+      double s1 = a.half_w() * unit(gen), t1 = a.half_h() * unit(gen);
+      double s2 = b.half_w() * unit(gen), t2 = b.half_h() * unit(gen);
+      double dx = d.x + s2 * u2.x + t2 * v2.x - s1 * u1.x - t1 * v1.x;
+      double dy = d.y + s2 * u2.y + t2 * v2.y - s1 * u1.y - t1 * v1.y;
+      double r = std::sqrt(dx * dx + dy * dy);
+      sum += r, sq += r * r;
+    }
+    double mean = sum / samples;
+    return std::make_pair(mean, std::sqrt((sq / samples - mean * mean)
+                                          / samples));
+  };
+
+  // Rectangles at equal angles are rotated onto the closed form, and the
+  // rotation by a right angle swaps the sides.
+  Rect<double> r1(0.0, 2.0, 0.0, 1.0), r2(1.5, 2.5, 0.5, 3.0);
+  double angle = 0.7, c = std::cos(angle), s = std::sin(angle);
+  ORect<double> o1({ 1.0 * c - 0.5 * s, 1.0 * s + 0.5 * c }, 1.0, 0.5, angle);
+  ORect<double> o2({ 2.0 * c - 1.75 * s, 2.0 * s + 1.75 * c }, 1.25, 0.5,
+                   angle + pi / 2);
+  std::cout << std::setprecision(16) << "rotated: "
+            << expected_dist(o1, o2) << ", rectangles: "
+            << expected_dist(r1, r2) << std::endl;
+
+  // A segment against itself has the known mean distance length / 3.
+  std::cout << "segment: "
+            << expected_dist(ORect<double>::segment({ 0, 0 }, { 3, 4 }),
+                             ORect<double>::segment({ 0, 0 }, { 3, 4 }))
+            << " (1.666666666666667)" << std::endl;
+
+  const std::vector<std::pair<ORect<double>, ORect<double> > > cases {
+    { { { 0, 0 }, 1, 0.5, 0.3 }, { { 0.5, 0.2 }, 0.7, 0.2, 1.1 } },
+    { ORect<double>::segment({ -1, -1 }, { 1, 1 }),
+      ORect<double>::segment({ -1, 1 }, { 1, -0.5 }) },
+    { ORect<double>::segment({ 0, 0 }, { 2, 0 }),
+      { { 1, 0 }, 0.5, 0.5, 0.7 } },
+    { { { 0, 0 }, 1, 1e-4, 0.2 }, { { 0.3, 0 }, 1, 2e-4, 1.3 } },
+    { { { 0, 0 }, 1, 0.5, 0.3 }, { { 0.4, 0.1 }, 0.7, 0.2, 0.3 + 1e-6 } },
+    { { { 0, 0 }, 1, 0.5, 0.3 }, { { 30, 4 }, 0.7, 0.2, 1.1 } }
+  };
+  std::cout << std::setprecision(8)
+            << "samples of Monte Carlo: " << samples << std::endl;
+  for (const auto& [ a, b ] : cases) {
+    auto t1 = std::chrono::steady_clock::now();
+    double exact = 0;
+    for (int k = 0; k < 1000; ++k) exact += expected_dist(a, b);
+    exact /= 1000;
+    auto t2 = std::chrono::steady_clock::now();
+    auto [ mean, error ] = monte_carlo(a, b);
+    auto t3 = std::chrono::steady_clock::now();
+    std::cout << "quadrature: " << exact << " in "
+              << ms(t2 - t1) << "us, Monte Carlo: " << mean
+              << " +- " << error << " in " << ms(t3 - t2) << "ms, "
+              << "deviation: " << (mean - exact) / error << " sigma"
+              << std::endl;
+  }
+
+  // The batch of random pairs at random angles.
+  const std::size_t size = 100000;
+  std::uniform_real_distribution<double> coord(0.0, 10.0), turn(0.0, pi);
+  std::lognormal_distribution<double> side(-1.0, 1.0);
+  auto random_orect = [&] {
+    return ORect<double>({ coord(gen), coord(gen) }, side(gen), side(gen),
+                         turn(gen));
+  };
+  std::vector<ORect<double> > lhs(size), rhs(size);
+  std::ranges::generate(lhs, random_orect);
+  std::ranges::generate(rhs, random_orect);
+  std::vector<double> result(size);
+  auto t1 = std::chrono::steady_clock::now();
+  expected_dist(std::span<const ORect<double> >(lhs),
+                std::span<const ORect<double> >(rhs), std::span(result));
+  auto t2 = std::chrono::steady_clock::now();
+  std::cout << "batch: " << ms(t2 - t1) << "ms for " << size << " pairs"
+            << std::endl;
+  return 0;
+}
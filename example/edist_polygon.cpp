@@ -0,0 +1,80 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <chrono>
+#include <vector>
+#include "polygon.hpp"
+#include "expected_dist_polygon.hpp"
+#include "expected_dist_qmc.hpp"
+using namespace fiocca;
+
+auto main() -> int {
+  // Typical zones of L, U and T shapes.
+  RectilinearPolygon<double> zones[] = {
+    RectilinearPolygon<double>({ { 0, 0 }, { 3, 0 }, { 3, 1 }, { 1, 1 },
+                                 { 1, 4 }, { 0, 4 } }),
+    RectilinearPolygon<double>({ { 5, 0 }, { 9, 0 }, { 9, 3 }, { 8, 3 },
+                                 { 8, 1 }, { 6, 1 }, { 6, 3 }, { 5, 3 } }),
+    RectilinearPolygon<double>({ { 2, 5 }, { 7, 5 }, { 7, 6 }, { 5, 6 },
+                                 { 5, 9 }, { 4, 9 }, { 4, 6 }, { 2, 6 } })
+  };
+  const char* names[] = { "L", "U", "T" };
+  for (std::size_t i = 0; i != std::size(zones); ++i)
+    std::cout << names[i] << ": " << zones[i].rects().size()
+              << " rectangles, area " << zones[i].area() << std::endl;
+
+  // Validate against the quasi-Monte Carlo estimates, where the points are
+  // sampled by selecting a rectangle in proportion to its area.
+  auto sampler = [](const RectilinearPolygon<double>& polygon) {
+    return [&polygon](double u, double v) {
+      for (const auto& rect : polygon.rects()) {
+        double p = rect.area() / polygon.area();
+        if (u < p || &rect == &polygon.rects().back()) {
+          u = std::min(u / p, 1.0);
+          return Point2d { rect.x1() + u * rect.w(), rect.y1() + v * rect.h() };
+        }
+        u -= p;
+      }
+      return Point2d { };
+    };
+  };
+  QmcSampler<double> qmc(1e-6);
+  std::cout << std::setprecision(8);
+  for (std::size_t i = 0; i != std::size(zones); ++i)
+    for (std::size_t j = i; j != std::size(zones); ++j) {
+      auto estimate = qmc.expected_dist(sampler(zones[i]), sampler(zones[j]));
+      std::cout << names[i] << "-" << names[j] << ": "
+                << expected_dist(zones[i], zones[j]) << ", qmc "
+                << estimate.value << " +/- " << estimate.error << std::endl;
+    }
+
+  // Many translated copies of the zones, evaluated pair by pair and in one
+  // batch. The decompositions are shared by all queries.
+  std::vector<RectilinearPolygon<double> > lhs, rhs;
+  for (int k = 0; k < 20000; ++k) {
+    auto shift = [&](const RectilinearPolygon<double>& zone, double dx) {
+      auto vertices = zone.vertices();
+      for (auto& p : vertices) p.x += dx, p.y += dx / 2;
+      return RectilinearPolygon<double>(vertices);
+    };
+    lhs.push_back(shift(zones[k % 3], 0.1 * (k % 37)));
+    rhs.push_back(shift(zones[(k / 3) % 3], 0.1 * (k % 41)));
+  }
+  std::vector<double> single(lhs.size()), batch(lhs.size());
+  auto t1 = std::chrono::steady_clock::now();
+  for (std::size_t k = 0; k != lhs.size(); ++k)
+    single[k] = expected_dist(lhs[k], rhs[k]);
+  auto t2 = std::chrono::steady_clock::now();
+  expected_dist<double>(lhs, rhs, batch);
+  auto t3 = std::chrono::steady_clock::now();
+  double max_error = 0;
+  for (std::size_t k = 0; k != lhs.size(); ++k)
+    max_error = std::max(max_error, std::fabs(batch[k] - single[k]));
+  auto elapsed = [](auto duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  };
+  std::cout << lhs.size() << " pairs: " << elapsed(t2 - t1)
+            << "ms pair by pair, " << elapsed(t3 - t2)
+            << "ms in batch, max difference " << max_error << std::endl;
+  return 0;
+}
@@ -0,0 +1,69 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <chrono>
+#include <numbers>
+#include "rect.hpp"
+#include "expected_dist.hpp"
+#include "expected_dist_qmc.hpp"
+using namespace fiocca;
+
+auto main() -> int {
+  // Validate the estimates against the closed representation, including
+  // overlapping, nested, separated and degenerated rectangles.
+  const Rect<double> pairs[][2] = {
+    { { 0.0, 1.0, 0.0, 1.0 }, { 0.0, 1.0, 0.0, 1.0 } },
+    { { 0.0, 4.0, 0.0, 3.0 }, { 1.0, 2.0, 0.5, 1.0 } },
+    { { 0.0, 2.0, 0.0, 1.0 }, { 1.0, 3.0, 0.5, 2.5 } },
+    { { 0.0, 1.0, 0.0, 5.0 }, { 7.0, 8.0, -2.0, 0.0 } },
+    { { 0.0, 3.0, 1.0, 1.0 }, { 2.0, 2.0, 0.0, 2.0 } }
+  };
+  std::cout << std::setprecision(8);
+  for (auto sequence : { QmcSequence::sobol, QmcSequence::halton }) {
+    QmcSampler<double> sampler(1e-6, 1 << 20, sequence);
+    std::cout << (sequence == QmcSequence::sobol ? "sobol" : "halton")
+              << std::endl;
+    for (const auto& [ lhs, rhs ] : pairs) {
+      double exact = expected_dist(lhs, rhs);
+      auto t1 = std::chrono::steady_clock::now();
+      auto [ value, error, points, converged ] =
+        expected_dist(lhs, rhs, sampler);
+      auto t2 = std::chrono::steady_clock::now();
+      std::cout << "  exact: " << exact << ", qmc: " << value
+                << " +/- " << std::setprecision(2) << error
+                << " (actual " << std::fabs(value - exact) << ", "
+                << points << " points x 16, "
+                << (converged ? "converged" : "not converged") << ", "
+                << std::chrono::duration<double, std::milli>(t2 - t1).count()
+                << "ms)" << std::setprecision(8) << std::endl;
+    }
+  }
+
+  // Arbitrary shapes are given by measure preserving maps from the unit
+  // square. The expected distance in a unit disk is 128 / (45 pi).
+  auto disk = [](double u, double v) {
+    double r = std::sqrt(u), theta = 2 * std::numbers::pi * v;
+    return Point2d { r * std::cos(theta), r * std::sin(theta) };
+  };
+  QmcSampler<double> sampler(1e-7);
+  auto estimate = sampler.expected_dist(disk, disk);
+  std::cout << "disk: exact " << 128 / (45 * std::numbers::pi)
+            << ", qmc " << estimate.value << " +/- " << estimate.error
+            << std::endl;
+
+  // A unit disk against a rectangle, compared with the numeric integral of
+  // the closed point to rectangle distance over the disk.
+  Rect<double> zone(2.0, 4.0, -1.0, 0.5);
+  auto reference = QmcSampler<double>(1e-8, 1 << 22).integrate<2>(
+    [&](const std::array<simd::native_t<double>, 2>& u) {
+      return simd::native_t<double>([&](auto lane) {
+        auto [ x, y ] = disk(u[0][lane], u[1][lane]);
+        return expected_dist(Point2d { x, y }, zone);
+      });
+    });
+  estimate = sampler.expected_dist(disk, zone);
+  std::cout << "disk to rectangle: reference " << reference.value
+            << ", qmc " << estimate.value << " +/- " << estimate.error
+            << std::endl;
+  return 0;
+}
@@ -0,0 +1,61 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <chrono>
+#include <vector>
+#include "rect.hpp"
+#include "expected_dist_batch.hpp"
+#include "expected_dist_sweep.hpp"
+using namespace fiocca;
+
+// Compare the sweep against the batch kernel over the translated pairs.
+void compare(const char* name, const Rect<double>& fixed,
+             const Rect<double>& moving, const SweepGrid<double>& grid) {
+  auto ns = [&](auto&& run) {
+    auto t1 = std::chrono::steady_clock::now();
+    run();
+    auto t2 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(t2 - t1).count()
+           / grid.size();
+  };
+  std::vector<double> sweep(grid.size()), batch(grid.size());
+  double sweep_time = ns([&] {
+    expected_dist_sweep(fixed, moving, grid, std::span(sweep));
+  });
+
+  std::vector<double> columns[8];
+  for (auto& column : columns) column.reserve(grid.size());
+  for (std::size_t i = 0; i < grid.ny; ++i)
+    for (std::size_t j = 0; j < grid.nx; ++j) {
+      double dx = grid.x0 + j * grid.dx, dy = grid.y0 + i * grid.dy;
+      const double coords[] = {
+        fixed.x1(), fixed.x2(), fixed.y1(), fixed.y2(),
+        moving.x1() + dx, moving.x2() + dx, moving.y1() + dy, moving.y2() + dy
+      };
+      for (int k = 0; k < 8; ++k) columns[k].push_back(coords[k]);
+    }
+  RectSpan<double> lhs { columns[0], columns[1], columns[2], columns[3] };
+  RectSpan<double> rhs { columns[4], columns[5], columns[6], columns[7] };
+  double batch_time = ns([&] {
+    expected_dist(lhs, rhs, std::span(batch));
+  });
+
+  double error = 0;
+  for (std::size_t i = 0; i < grid.size(); ++i)
+    error = std::max(error, std::fabs(sweep[i] - batch[i]) / batch[i]);
+  std::cout << name << ": sweep " << sweep_time << "ns/cell, batch "
+            << batch_time << "ns/cell, max deviation " << error << std::endl;
+}
+
+auto main(int argc, char* argv[]) -> int {
+  std::size_t size = argc > 1 ? std::stoul(argv[1]) : 400;
+  std::cout << std::setprecision(4);
+  // The sizes are multiples of the steps, so that the breakpoints coincide.
+  double step = 40.0 / size;
+  compare("aligned", Rect<double>(0, 2, 0, 1), Rect<double>(0, 1, 0, 0.5),
+          { -20, step, size, -20, step, size });
+  compare("non-aligned", Rect<double>(0, 2.1, 0, 1.3),
+          Rect<double>(0, 0.77, 0, 0.51),
+          { -20, step * 1.013, size, -20, step * 0.987, size });
+  return 0;
+}
@@ -0,0 +1,57 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <array>
+#include "rect.hpp"
+#include "expected_dist.hpp"
+using namespace fiocca;
+
+// The footprints of standard cells, whose placements are on a regular grid
+// with a pitch of 4 in both dimensions.
+constexpr std::array<Rect<double>, 4> footprints = { {
+  { 0.0, 1.0, 0.0, 1.0 }, { 0.0, 2.0, 0.0, 1.0 },
+  { 0.0, 1.0, 0.0, 3.0 }, { 0.0, 0.0, 0.0, 2.0 }
+} };
+constexpr std::size_t nfoot = footprints.size(), noffset = 3;
+
+// Move a footprint by a number of grid pitches.
+constexpr auto place(const Rect<double>& rect, int i, int j) {
+  return Rect<double>(rect.x1() + 4 * i, rect.x2() + 4 * i,
+                      rect.y1() + 4 * j, rect.y2() + 4 * j);
+}
+
+// The expected distances between all pairs of footprints, with the second
+// footprint moved by (i, j) pitches, are baked in at compile time.
+static constexpr auto table = [] {
+  std::array<double, nfoot * nfoot * noffset * noffset> result { };
+  std::size_t k = 0;
+  for (const auto& lhs : footprints)
+    for (const auto& rhs : footprints)
+      for (std::size_t i = 0; i != noffset; ++i)
+        for (std::size_t j = 0; j != noffset; ++j)
+          result[k++] = expected_dist(lhs, place(rhs, i, j));
+  return result;
+}();
+
+// A single far apart pair, which takes the far-field expansion.
+static constexpr double far = expected_dist(
+  footprints[0], place(footprints[2], 100, 40));
+
+auto main() -> int {
+  double max_error = 0;
+  std::size_t k = 0;
+  for (const auto& lhs : footprints)
+    for (const auto& rhs : footprints)
+      for (std::size_t i = 0; i != noffset; ++i)
+        for (std::size_t j = 0; j != noffset; ++j) {
+          double expected = expected_dist(lhs, place(rhs, i, j));
+          max_error = std::max(max_error,
+            std::fabs(table[k++] - expected) / expected);
+        }
+  std::cout << std::setprecision(17)
+            << "table[0]: " << table[0] << "\n"
+            << "far: " << far << "\n" << std::setprecision(4)
+            << "max relative error of " << table.size()
+            << " entries: " << max_error << std::endl;
+  return 0;
+}
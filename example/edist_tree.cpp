@@ -0,0 +1,73 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "rect.hpp"
+#include "expected_dist.hpp"
+#include "expected_dist_tree.hpp"
+using namespace fiocca;
+
+auto main(int argc, char* argv[]) -> int {
+  std::size_t size = argc > 1 ? std::stoul(argv[1]) : 20000;
+
+  // A random weighted layout of rectangles of various sizes.
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> coord(0.0, 1000.0), side(0.1, 8.0);
+  std::vector<Rect<double> > rects;
+  std::vector<double> weights;
+  for (std::size_t i = 0; i < size; ++i) {
+    double x = coord(gen), y = coord(gen) / 2;
+    rects.emplace_back(x, x + side(gen), y, y + side(gen));
+    weights.push_back(side(gen));
+  }
+
+  // The exact sums of a few rectangles by the quadratic loop.
+  std::size_t nchecks = std::min<std::size_t>(size, 100);
+  std::vector<double> exact(nchecks);
+  auto t1 = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < nchecks; ++i)
+    for (std::size_t j = 0; j < size; ++j)
+      if (j != i) exact[i] += weights[j] * expected_dist(rects[i], rects[j]);
+  auto t2 = std::chrono::steady_clock::now();
+  std::cout << std::setprecision(4) << "quadratic: "
+            << std::chrono::duration<double>(t2 - t1).count() / nchecks
+               * size << "s (extrapolated)" << std::endl;
+
+  for (double theta : { 0.3, 0.5, 0.7 }) {
+    auto t3 = std::chrono::steady_clock::now();
+    DistTree<double> tree(rects, weights, theta);
+    std::vector<double> sums(size);
+    tree.sums(sums);
+    auto t4 = std::chrono::steady_clock::now();
+
+    double max_error = 0;
+    for (std::size_t i = 0; i < nchecks; ++i)
+      max_error = std::max(max_error, std::fabs(sums[i] - exact[i]) / exact[i]);
+    std::cout << "theta " << theta << ": "
+              << std::chrono::duration<double>(t4 - t3).count()
+              << "s, max relative error: " << max_error << std::endl;
+  }
+
+  // A layout whose size is not a multiple of the leaf size, so that the
+  // last leaf ends inside a simd block; build with -DFIOCCA_SANITIZE=ON to
+  // check the loads of the leaves.
+  std::vector<Rect<double> > grid;
+  for (int i = 0; i < 6; ++i)
+    for (int j = 0; j < 6; ++j) grid.emplace_back(i, i + 1, j, j + 1);
+  DistTree<double> small_tree(grid, { }, 0.5, 16);
+  std::vector<double> small_sums(grid.size());
+  small_tree.sums(small_sums);
+  double small_error = 0;
+  for (std::size_t i = 0; i < grid.size(); ++i) {
+    double sum = 0;
+    for (std::size_t j = 0; j < grid.size(); ++j)
+      if (j != i) sum += expected_dist(grid[i], grid[j]);
+    small_error = std::max(small_error,
+                           std::fabs(small_sums[i] - sum) / sum);
+  }
+  std::cout << "36 unit squares: max relative error " << small_error
+            << std::endl;
+  return 0;
+}
@@ -0,0 +1,70 @@
+#ifndef FIOCCA_BOX_HPP_
+#define FIOCCA_BOX_HPP_
+
+#include <tuple>
+#include <cmath>
+#include <algorithm>
+#include "point.hpp"
+
+namespace fiocca {
+
+/**
+ * @brief A simple three-dimensional axis-aligned box class, the counterpart
+ *  of @Rect.
+ */
+template<class DataType>
+class Box {
+public:
+  // Default constructor with no argument/six coordinates.
+  constexpr Box() : p1({ 0, 0, 0 }), p2({ 0, 0, 0 }) { }
+  constexpr Box(DataType x1_, DataType x2_, DataType y1_, DataType y2_,
+                DataType z1_, DataType z2_)
+      : p1({ std::min(x1_, x2_), std::min(y1_, y2_), std::min(z1_, z2_) }),
+        p2({ std::max(x1_, x2_), std::max(y1_, y2_), std::max(z1_, z2_) }) {
+    // Make sure x1 <= x2, y1 <= y2 and z1 <= z2 as @Rect does.
+  }
+
+  // Construct box from two opposite corner points.
+  constexpr Box(const Point3<DataType>& p1_, const Point3<DataType>& p2_)
+      : Box(p1_.x, p2_.x, p1_.y, p2_.y, p1_.z, p2_.z) { }
+
+  // Attribute accessors.
+  constexpr auto x1() const { return p1.x; }
+  constexpr auto x2() const { return p2.x; }
+  constexpr auto y1() const { return p1.y; }
+  constexpr auto y2() const { return p2.y; }
+  constexpr auto z1() const { return p1.z; }
+  constexpr auto z2() const { return p2.z; }
+
+  // The lowest and highest corner points.
+  constexpr const auto& lo() const { return p1; }
+  constexpr const auto& hi() const { return p2; }
+
+  // Shape calculators.
+  constexpr auto w() const { return p2.x - p1.x; }
+  constexpr auto h() const { return p2.y - p1.y; }
+  constexpr auto d() const { return p2.z - p1.z; }
+  constexpr auto shape() const {
+    return std::make_tuple(p2.x - p1.x, p2.y - p1.y, p2.z - p1.z);
+  }
+
+  // Other geometric attributes.
+  constexpr auto volume() const { return w() * h() * d(); }
+  constexpr auto surface() const {
+    return 2 * (w() * h() + h() * d() + d() * w());
+  }
+  auto diam() const { return std::hypot(w(), h(), d()); }
+
+  // Whether a point is inside the box.
+  constexpr auto contain(const Point3<DataType>& p) const {
+    return dominate(p, p1) && dominate(p2, p);
+  }
+
+protected:
+  // The lowest and highest corners of the box.
+  Point3<DataType> p1, p2;
+};
+
+} // namespace fiocca
+
+#endif // FIOCCA_BOX_HPP_
@@ -0,0 +1,219 @@
+#ifndef FIOCCA_EXPECTED_DIST_ADAPTIVE_HPP_
+#define FIOCCA_EXPECTED_DIST_ADAPTIVE_HPP_
+
+#include <span>
+#include <array>
+#include <vector>
+#include <cmath>
+#include <tuple>
+#include <limits>
+#include <utility>
+#include <algorithm>
+#include "rect.hpp"
+#include "box.hpp"
+#include "expected_dist.hpp"
+#include "expected_dist_box.hpp"
+#include "expected_dist_batch.hpp"
+
+namespace fiocca {
+
+/**
+ * @brief The default relative tolerance of expected_dist_adaptive(), above
+ *  which the estimated error of the fast path triggers a rerun in extended
+ *  precision. A rerun costs about as much as twenty pairs of the batch, so
+ *  the tolerance of double keeps the batch within about 10% of
+ *  expected_dist() on typical pairs, where 0.1% of them are rerun, against
+ *  14% of pairs and several times the time for 1e-12. Float pairs are
+ *  rerun by the batch in double instead, e.g. 89% of typical pairs at
+ *  about 2.7 times the time of the float batch.
+ */
+template<class DataType>
+requires floating<DataType>
+inline constexpr DataType adaptive_tolerance =
+    sizeof(DataType) == sizeof(float)? 1e-5
+  : sizeof(DataType) == sizeof(double)? 1e-9 : 1e-15;
+
+namespace detail {
+
+/**
+ * @brief An estimate of the absolute error of @value, the expected distance
+ *  evaluated by @TwinRect (or @TwinRectSimd) in DataType. The closed
+ *  representation cancels as the epsilon times _cancellation(), which is
+ *  large for thin, nearly coincident or distant rectangles. The constant
+ *  is calibrated against an extended-precision reference, where long
+ *  double exceeds 4 by up to 1.5 times just above its far-field threshold.
+ *  The promoted pairs take the epsilon of double, and the far field takes
+ *  the truncation bound of the series instead.
+ */
+template<class DataType>
+requires floating<DataType>
+constexpr auto _dist_error(const Rect<DataType>& lhs,
+                           const Rect<DataType>& rhs,
+                           DataType value) -> DataType {
+  constexpr DataType eps = std::numeric_limits<DataType>::epsilon();
+  constexpr DataType factor = sizeof(DataType) > sizeof(double)? 8 : 4;
+  if (separation_ratio(lhs, rhs) < far_field_ratio<DataType>)
+    return expected_dist_far(lhs, rhs).second + 4 * eps * value;
+  DataType scale = _cancellation(lhs, rhs);
+  // The promoted pairs are only rounded to DataType at last.
+  if (_promoted(lhs, rhs))
+    return 4 * static_cast<DataType>(std::numeric_limits<double>::epsilon())
+         * scale + eps * value;
+  return factor * eps * (scale + value);
+}
+
+/**
+ * @brief The expected distance in extended precision and its error, where
+ *  the error is relative to @tolerance as in expected_dist_adaptive(). The
+ *  closed representation in long double runs first if it is wider than
+ *  DataType, and otherwise the rectangles are embedded as flat boxes,
+ *  whose Gaussian transform never subtracts nearly equal quantities, see
+ *  detail::_box_transform(). The transform is called directly even for
+ *  distant pairs, since expected_dist() of boxes would take the truncated
+ *  far-field series there, whose error is not a rounding error. The
+ *  rounding to DataType is added to the error.
+ */
+template<class DataType>
+requires floating<DataType>
+auto _dist_extended(const Rect<DataType>& lhs, const Rect<DataType>& rhs,
+                    DataType tolerance) -> std::pair<DataType, DataType> {
+  using wide_t = long double;
+  Rect<wide_t> a(lhs.x1(), lhs.x2(), lhs.y1(), lhs.y2());
+  Rect<wide_t> b(rhs.x1(), rhs.x2(), rhs.y1(), rhs.y2());
+  wide_t value = 0, error = std::numeric_limits<wide_t>::infinity();
+  if constexpr (sizeof(wide_t) > sizeof(DataType)) {
+    value = expected_dist(a, b);
+    error = _dist_error(a, b, value);
+  }
+  if (error > tolerance * _dist_lower_bound(a, b)) {
+    value = _box_transform(Box<wide_t>(a.x1(), a.x2(), a.y1(), a.y2(), 0, 0),
+                           Box<wide_t>(b.x1(), b.x2(), b.y1(), b.y2(), 0, 0));
+    error = 16 * std::numeric_limits<wide_t>::epsilon() * value;
+  }
+  DataType result = static_cast<DataType>(value);
+  return { result, static_cast<DataType>(error) + result
+                   * std::numeric_limits<DataType>::epsilon() / 2 };
+}
+
+} // namespace detail
+
+/**
+ * @brief Calculate the expected distance between two rectangles with a
+ *  guarded precision. The fast closed representation runs first, and the
+ *  pair is rerun in extended precision only if the estimated error exceeds
+ *  @tolerance relative to a lower bound of the distance.
+ * @return the expected distance and an estimate of its absolute error.
+ */
+template<class DataType>
+requires floating<DataType>
+auto expected_dist_adaptive(const Rect<DataType>& lhs,
+                            const Rect<DataType>& rhs,
+                            DataType tolerance = adaptive_tolerance<DataType>)
+    -> std::pair<DataType, DataType> {
+  DataType value = expected_dist(lhs, rhs);
+  DataType error = detail::_dist_error(lhs, rhs, value);
+  if (error <= tolerance * detail::_dist_lower_bound(lhs, rhs))
+    return { value, error };
+  return detail::_dist_extended(lhs, rhs, tolerance);
+}
+
+/**
+ * @brief Calculate the expected distances between pairs of rectangles
+ *  stored as structure-of-arrays with a guarded precision. All pairs run
+ *  the simd closed representation first, which also estimates the errors
+ *  in its lanes, see TwinRectSimd::error(). The flagged pairs are gathered
+ *  and rerun in parallel: in precisions narrower than double by this batch
+ *  in double, including the promoted pairs, and otherwise in extended
+ *  precision, see the scalar version.
+ * @param result the output buffer of expected distances.
+ * @param error the output buffer of the estimates of absolute errors.
+ * @return the number of pairs rerun in a wider precision.
+ */
+template<class DataType>
+requires floating<DataType>
+auto expected_dist_adaptive(const RectSpan<DataType>& lhs,
+                            const RectSpan<DataType>& rhs,
+                            std::span<DataType> result,
+                            std::span<DataType> error,
+                            DataType tolerance = adaptive_tolerance<DataType>)
+    -> std::size_t {
+  using twin_type = TwinRectSimd<DataType>;
+  using value_type = typename twin_type::value_type;
+  constexpr std::size_t width = twin_type::size();
+  constexpr auto aligned = simd::stdx::element_aligned;
+  constexpr bool promotes = sizeof(DataType) < sizeof(double);
+  const std::size_t size = lhs.size();
+  const std::span<const DataType> columns[] = {
+    lhs.x1, lhs.x2, lhs.y1, lhs.y2, rhs.x1, rhs.x2, rhs.y1, rhs.y2
+  };
+
+  // The remaining pairs are padded with unit squares to fill a vector.
+  std::vector<unsigned char> flagged(size);
+#pragma omp parallel for
+  for (std::size_t i = 0; i < size; i += width) {
+    const bool full = i + width <= size;
+    std::array<value_type, 8> c;
+    for (std::size_t k = 0; k != 8; ++k)
+      c[k] = full ? value_type(&columns[k][i], aligned)
+                  : value_type([&](auto lane) {
+                      return i + lane < size ? columns[k][i + lane]
+                                             : DataType(k % 2);
+                    });
+    twin_type twin_rect(c[0], c[1], c[2], c[3], c[4], c[5], c[6], c[7],
+                        promotes);
+    value_type dist = twin_rect.dist(), err = twin_rect.error(dist);
+    auto rerun = err > tolerance * detail::_dist_lower_bound(
+      c[0], c[1], c[2], c[3], c[4], c[5], c[6], c[7]);
+    rerun = rerun || twin_rect.promoted();
+    if (full) {
+      dist.copy_to(&result[i], aligned);
+      err.copy_to(&error[i], aligned);
+    } else
+      for (std::size_t lane = 0; i + lane < size; ++lane)
+        result[i + lane] = dist[lane], error[i + lane] = err[lane];
+    if (simd::stdx::any_of(rerun))
+      for (std::size_t lane = 0; lane != width && i + lane < size; ++lane)
+        flagged[i + lane] = rerun[lane];
+  }
+
+  std::vector<std::size_t> index;
+  for (std::size_t i = 0; i != size; ++i)
+    if (flagged[i]) index.push_back(i);
+  const std::size_t count = index.size();
+  if constexpr (promotes) {
+    // The wider closed representation runs in simd lanes as well, and is
+    // rounded back to DataType.
+    if (!count) return 0;
+    std::vector<double> coords(count * 8), dist(count), err(count);
+    for (std::size_t k = 0; k != 8; ++k)
+      for (std::size_t j = 0; j != count; ++j)
+        coords[k * count + j] = columns[k][index[j]];
+    auto column = [&](std::size_t k) {
+      return std::span<const double>(coords).subspan(k * count, count);
+    };
+    expected_dist_adaptive(
+      RectSpan<double> { column(0), column(1), column(2), column(3) },
+      RectSpan<double> { column(4), column(5), column(6), column(7) },
+      std::span<double>(dist), std::span<double>(err), double(tolerance));
+    constexpr DataType eps = std::numeric_limits<DataType>::epsilon();
+    for (std::size_t j = 0; j != count; ++j) {
+      result[index[j]] = static_cast<DataType>(dist[j]);
+      error[index[j]] = static_cast<DataType>(err[j])
+                      + result[index[j]] * eps / 2;
+    }
+  } else {
+#pragma omp parallel for
+    for (std::size_t j = 0; j < count; ++j) {
+      const std::size_t i = index[j];
+      std::tie(result[i], error[i]) = detail::_dist_extended(
+        Rect<DataType>(lhs.x1[i], lhs.x2[i], lhs.y1[i], lhs.y2[i]),
+        Rect<DataType>(rhs.x1[i], rhs.x2[i], rhs.y1[i], rhs.y2[i]),
+        tolerance);
+    }
+  }
+  return count;
+}
+
+} // namespace fiocca
+
+#endif // FIOCCA_EXPECTED_DIST_ADAPTIVE_HPP_
@@ -0,0 +1,730 @@
+#ifndef FIOCCA_EXPECTED_DIST_BATCH_HPP_
+#define FIOCCA_EXPECTED_DIST_BATCH_HPP_
+
+#include <span>
+#include <array>
+#include <vector>
+#include "simd.hpp"
+#include "expected_dist.hpp"
+
+namespace fiocca {
+
+/**
+ * @brief A structure-of-arrays view of rectangles. The i-th rectangle is
+ *  represented by (x1[i], x2[i], y1[i], y2[i]). Similar to @Rect, the
+ *  coordinates are allowed to be unordered in each dimension.
+ *  The struct does not own any data, and all spans should have the same
+ *  size (only the size of @x1 is checked).
+ */
+template<class DataType>
+struct RectSpan {
+  using type = DataType;
+  constexpr auto size() const { return x1.size(); }
+
+  // Coordinates of all rectangles.
+  std::span<const DataType> x1, x2, y1, y2;
+};
+
+/**
+ * @brief A structure-of-arrays view of points. The i-th point is
+ *  represented by (x[i], y[i]). Similar to @RectSpan, the struct does not
+ *  own any data and both spans should have the same size.
+ */
+template<class DataType>
+struct PointSpan {
+  using type = DataType;
+  constexpr auto size() const { return x.size(); }
+
+  // Coordinates of all points.
+  std::span<const DataType> x, y;
+};
+
+namespace detail {
+
+// Data-parallel counterpart of detail::_dist_lower_bound() for the pairs of
+// rectangles given by their coordinates, rounded in the same order.
+template<class Simd>
+requires simd::vectorized<Simd>
+auto _dist_lower_bound(const Simd& ax1, const Simd& ax2,
+                       const Simd& ay1, const Simd& ay2,
+                       const Simd& bx1, const Simd& bx2,
+                       const Simd& by1, const Simd& by2) -> Simd {
+  Simd ax_lo = simd::stdx::min(ax1, ax2), ax_hi = simd::stdx::max(ax1, ax2);
+  Simd ay_lo = simd::stdx::min(ay1, ay2), ay_hi = simd::stdx::max(ay1, ay2);
+  Simd bx_lo = simd::stdx::min(bx1, bx2), bx_hi = simd::stdx::max(bx1, bx2);
+  Simd by_lo = simd::stdx::min(by1, by2), by_hi = simd::stdx::max(by1, by2);
+  Simd w1 = ax_hi - ax_lo, h1 = ay_hi - ay_lo;
+  Simd w2 = bx_hi - bx_lo, h2 = by_hi - by_lo;
+  Simd dx = (bx1 + bx2 - ax_lo - ax_hi) / 2;
+  Simd dy = (by1 + by2 - ay_lo - ay_hi) / 2;
+  Simd mx = simd::stdx::max(bx_hi - ax_lo, ax_hi - bx_lo);
+  Simd my = simd::stdx::max(by_hi - ay_lo, ay_hi - by_lo);
+  Simd dmax = simd::sqrt(mx * mx + my * my);
+  Simd rsq = dx * dx + dy * dy;
+  Simd var = (w1 * w1 + w2 * w2 + h1 * h1 + h2 * h2) / 12;
+  Simd bound = simd::stdx::max(simd::sqrt(rsq), (rsq + var) / dmax);
+  where(dmax == 0, bound) = 0;
+  return bound;
+}
+
+} // namespace detail
+
+/**
+ * @brief A system consisting of several pairs of rectangles, one pair in
+ *  each simd lane. This is the data-parallel counterpart of @TwinRect,
+ *  evaluating exactly the same closed representation (or the far-field
+ *  expansion in the same lanes as the scalar version). Since the lanes may
+ *  fall into different degeneracy cases, all branches are replaced by masks
+ *  and a branch is only evaluated if at least one lane requires it.
+ */
+template<class DataType, class Abi = simd::stdx::simd_abi::native<DataType> >
+requires floating<DataType>
+class TwinRectSimd {
+public:
+  using value_type = simd::stdx::simd<DataType, Abi>;
+  using mask_type = typename value_type::mask_type;
+  static constexpr std::size_t size() { return value_type::size(); }
+
+  // Construct the system from coordinates of the two rectangles in each
+  // lane. The coordinates are sorted as the constructor of @Rect does. The
+  // lanes flagged by promoted() beyond @tolerance are evaluated in double
+  // here, unless @defer is set, where dist() leaves them zero for the
+  // caller.
+  TwinRectSimd(const value_type& ax1, const value_type& ax2,
+               const value_type& ay1, const value_type& ay2,
+               const value_type& bx1, const value_type& bx2,
+               const value_type& by1, const value_type& by2,
+               bool defer = false,
+               DataType tolerance = promotion_tolerance<DataType>) {
+    value_type w1 = simd::stdx::abs(ax2 - ax1);
+    value_type h1 = simd::stdx::abs(ay2 - ay1);
+    value_type w2 = simd::stdx::abs(bx2 - bx1);
+    value_type h2 = simd::stdx::abs(by2 - by1);
+    delta1 = simd::stdx::min(bx1, bx2) - simd::stdx::min(ax1, ax2);
+    delta2 = simd::stdx::min(by1, by2) - simd::stdx::min(ay1, ay2);
+    w1_ = w1 != 0, w2_ = w2 != 0, h1_ = h1 != 0, h2_ = h2 != 0;
+
+    // The degenerated dimensions do not contribute to the area.
+    value_type fw1 = w1, fh1 = h1, fw2 = w2, fh2 = h2;
+    where(!w1_, fw1) = 1, where(!h1_, fh1) = 1;
+    where(!w2_, fw2) = 1, where(!h2_, fh2) = 1;
+    factor = fw1 * fh1 * fw2 * fh2;
+
+    value_type lb1 = simd::stdx::min(value_type(0), w2 - w1);
+    value_type ub1 = simd::stdx::max(value_type(0), w2 - w1);
+    value_type lb2 = simd::stdx::min(value_type(0), h2 - h1);
+    value_type ub2 = simd::stdx::max(value_type(0), h2 - h1);
+    coord0 = { delta1 - w1, delta1 + lb1, delta1 + ub1, delta1 + w2 };
+    coord1 = { delta2 - h1, delta2 + lb2, delta2 + ub2, delta2 + h2 };
+    for (std::size_t k = 0; k != 4; ++k) xsq[k] = coord0[k] * coord0[k];
+
+    // The lanes evaluated by the far-field expansion. The offsets are
+    // rounded in the same order as separation_ratio() and
+    // expected_dist_far() so that the lanes agree with the scalar version.
+    value_type dx = bx1 + bx2 - simd::stdx::min(ax1, ax2)
+                              - simd::stdx::max(ax1, ax2);
+    value_type dy = by1 + by2 - simd::stdx::min(ay1, ay2)
+                              - simd::stdx::max(ay1, ay2);
+    far_ = simd::sqrt(detail::_separation_sq(w1, h1, w2, h2, dx, dy))
+         < far_field_ratio<DataType>;
+    if (simd::stdx::any_of(far_)) {
+      dx /= 2, dy /= 2;
+      std::tie(far_dist_, far_error_) = detail::_far_field(
+        dx, dy, simd::sqrt(dx * dx + dy * dy), w1, h1, w2, h2);
+    }
+    if constexpr (sizeof(DataType) < sizeof(double))
+      _promote(ax1, ax2, ay1, ay2, bx1, bx2, by1, by2, defer, tolerance);
+    _row_logs(!far_ && !promoted_);
+  }
+
+  /**
+   * @brief The terms of the y-dimension, which only depend on the
+   *  y-coordinates of the two rectangles, e.g. shared by all cells of a row
+   *  of a translation grid, see @DistSweep.
+   */
+  struct RowTerms {
+    mask_type h1, h2;
+    value_type fh1, fh2, delta2;
+    std::array<value_type, 4> coord1, ysq, logy;
+    value_type logd;
+  };
+
+  // Compute the terms of the y-dimension once for several systems.
+  static auto row_terms(const value_type& ay1, const value_type& ay2,
+                        const value_type& by1, const value_type& by2)
+      -> RowTerms {
+    TwinRectSimd system;
+    value_type h1 = simd::stdx::abs(ay2 - ay1);
+    value_type h2 = simd::stdx::abs(by2 - by1);
+    system.delta2 = simd::stdx::min(by1, by2) - simd::stdx::min(ay1, ay2);
+    system.h1_ = h1 != 0, system.h2_ = h2 != 0;
+    value_type lb2 = simd::stdx::min(value_type(0), h2 - h1);
+    value_type ub2 = simd::stdx::max(value_type(0), h2 - h1);
+    const value_type& delta2 = system.delta2;
+    system.coord1 = { delta2 - h1, delta2 + lb2, delta2 + ub2, delta2 + h2 };
+    system._row_logs(mask_type(true));
+    value_type fh1 = h1, fh2 = h2;
+    where(!system.h1_, fh1) = 1, where(!system.h2_, fh2) = 1;
+    return { system.h1_, system.h2_, fh1, fh2, system.delta2,
+             system.coord1, system.ysq, system.logy, system.logd };
+  }
+
+  /**
+   * @brief The terms of the x-dimension, which only depend on the
+   *  x-coordinates of the two rectangles, e.g. shared by all cells of a
+   *  column of a translation grid, see @DistSweep.
+   */
+  struct ColumnTerms {
+    mask_type w1, w2;
+    value_type fw1, fw2, delta1;
+    std::array<value_type, 4> coord0, xsq;
+  };
+
+  // Compute the terms of the x-dimension once for several systems.
+  static auto column_terms(const value_type& ax1, const value_type& ax2,
+                           const value_type& bx1, const value_type& bx2)
+      -> ColumnTerms {
+    ColumnTerms column;
+    value_type w1 = simd::stdx::abs(ax2 - ax1);
+    value_type w2 = simd::stdx::abs(bx2 - bx1);
+    column.delta1 = simd::stdx::min(bx1, bx2) - simd::stdx::min(ax1, ax2);
+    column.w1 = w1 != 0, column.w2 = w2 != 0;
+    column.fw1 = w1, column.fw2 = w2;
+    where(!column.w1, column.fw1) = 1, where(!column.w2, column.fw2) = 1;
+    value_type lb1 = simd::stdx::min(value_type(0), w2 - w1);
+    value_type ub1 = simd::stdx::max(value_type(0), w2 - w1);
+    const value_type& delta1 = column.delta1;
+    column.coord0 = { delta1 - w1, delta1 + lb1, delta1 + ub1, delta1 + w2 };
+    for (std::size_t k = 0; k != 4; ++k)
+      column.xsq[k] = column.coord0[k] * column.coord0[k];
+    return column;
+  }
+
+  // Construct the system from the terms of the x- and y-dimensions. All
+  // lanes are evaluated by the closed representation, i.e. the far-field
+  // expansion and the promotion are left to the caller.
+  TwinRectSimd(const ColumnTerms& column, const RowTerms& row)
+      : w1_(column.w1), h1_(row.h1), w2_(column.w2), h2_(row.h2),
+        far_(false), delta1(column.delta1), delta2(row.delta2),
+        factor(column.fw1 * row.fh1 * column.fw2 * row.fh2),
+        coord0(column.coord0), coord1(row.coord1), xsq(column.xsq),
+        ysq(row.ysq), logy(row.logy), logd(row.logd) { }
+
+  /**
+   * @brief Compute the average distance in each lane. Refer to the scalar
+   *  version TwinRect::dist() for details of the closed representation.
+   */
+  auto dist() const -> value_type {
+    // [FAR FIELD] the series is taken in the far lanes, and the closed
+    // representation is skipped if all lanes are far.
+    if (simd::stdx::all_of(far_)) return far_dist_;
+    value_type result = 0;
+    // [PROMOTION] the promoted lanes are evaluated in double beforehand.
+    mask_type near = !far_ && !promoted_;
+    mask_type case1 = near && w1_ && w2_, case2 = near && !w1_ && !w2_;
+    mask_type case3 = near && !(case1 || case2);
+    // [CASE 1] the two rectangles both have positive width.
+    // The antiderivatives are evaluated only once at each breakpoint.
+    if (simd::stdx::any_of(case1)) {
+      std::array<value_type, 4> d, xd;
+      for (std::size_t k = 0; k != 4; ++k)
+        std::tie(d[k], xd[k]) = _idfint_dens(coord0[k], xsq[k]);
+      where(case1, result) = (xd[1] - xd[0]) - (xd[3] - xd[2])
+                           + (d[2] - d[1]) * (coord0[1] - coord0[0])
+                           - (d[1] - d[0]) * coord0[0]
+                           + (d[3] - d[2]) * coord0[3];
+    }
+    // [CASE 2] the two rectangles are both degraded to vertical lines.
+    if (simd::stdx::any_of(case2))
+      where(case2, result) = dens(delta1);
+    // [CASE 3] verticle line to rectangle/horizontal line.
+    if (simd::stdx::any_of(case3))
+      where(case3, result) = _idfint_dens(coord0[3], xsq[3]).first
+                           - _idfint_dens(coord0[0], xsq[0]).first;
+    result /= factor;
+    if (simd::stdx::any_of(far_)) where(far_, result) = far_dist_;
+    if (simd::stdx::any_of(promoted_))
+      where(promoted_, result) = promoted_dist_;
+    return result;
+  }
+
+  // The lanes evaluated in double, see promotion_tolerance.
+  auto promoted() const -> const mask_type& { return promoted_; }
+
+  /**
+   * @brief An estimate of the absolute error of @dist, the result of dist()
+   *  in each lane, see detail::_dist_error(). The cancellation is taken
+   *  from the outermost breakpoints, which are the differences of
+   *  detail::_cancellation(). The promoted lanes are left to the caller.
+   */
+  auto error(const value_type& dist) const -> value_type {
+    constexpr DataType eps = std::numeric_limits<DataType>::epsilon();
+    constexpr DataType weight = sizeof(DataType) > sizeof(double)? 8 : 4;
+    value_type m = simd::stdx::max(
+      simd::stdx::max(simd::stdx::abs(coord0[0]), simd::stdx::abs(coord0[3])),
+      simd::stdx::max(simd::stdx::abs(coord1[0]), simd::stdx::abs(coord1[3])));
+    value_type scale = m;
+    where(w1_, scale) *= m, where(h1_, scale) *= m;
+    where(w2_, scale) *= m, where(h2_, scale) *= m;
+    value_type result = weight * eps * (scale / factor + dist);
+    if (simd::stdx::any_of(far_))
+      where(far_, result) = far_error_ + 4 * eps * dist;
+    return result;
+  }
+
+private:
+  TwinRectSimd() = default;
+
+  // The squares and logarithms of |coord1|, and the logarithm of |delta2|,
+  // computed only if the lanes in @used require them.
+  void _row_logs(const mask_type& used) {
+    ysq = { }, logy = { }, logd = 0;
+    if (simd::stdx::any_of(h1_ && h2_ && used))
+      for (std::size_t k = 0; k != 4; ++k) {
+        ysq[k] = coord1[k] * coord1[k];
+        logy[k] = simd::log(simd::stdx::abs(coord1[k]));
+      }
+    if (simd::stdx::any_of(!h1_ && !h2_ && used))
+      logd = simd::log(simd::stdx::abs(delta2));
+  }
+
+  // Flag the near lanes whose closed representation cancels beyond
+  // @tolerance, and evaluate them by the scalar version in double unless
+  // @defer is set.
+  // The estimate is rounded in the same order as detail::_promoted(), so
+  // that the lanes agree with TwinRect::dist().
+  void _promote(const value_type& ax1, const value_type& ax2,
+                const value_type& ay1, const value_type& ay2,
+                const value_type& bx1, const value_type& bx2,
+                const value_type& by1, const value_type& by2,
+                bool defer, DataType tolerance) {
+    constexpr DataType eps = std::numeric_limits<DataType>::epsilon();
+    value_type ax_lo = simd::stdx::min(ax1, ax2);
+    value_type ax_hi = simd::stdx::max(ax1, ax2);
+    value_type ay_lo = simd::stdx::min(ay1, ay2);
+    value_type ay_hi = simd::stdx::max(ay1, ay2);
+    value_type bx_lo = simd::stdx::min(bx1, bx2);
+    value_type bx_hi = simd::stdx::max(bx1, bx2);
+    value_type by_lo = simd::stdx::min(by1, by2);
+    value_type by_hi = simd::stdx::max(by1, by2);
+
+    // The cancellation, see detail::_cancellation().
+    value_type m = simd::stdx::max(
+      simd::stdx::max(simd::stdx::abs(bx_lo - ax_hi),
+                      simd::stdx::abs(bx_hi - ax_lo)),
+      simd::stdx::max(simd::stdx::abs(by_lo - ay_hi),
+                      simd::stdx::abs(by_hi - ay_lo)));
+    value_type scale = m;
+    where(w1_, scale) *= m, where(h1_, scale) *= m;
+    where(w2_, scale) *= m, where(h2_, scale) *= m;
+
+    // The lower bound, see detail::_dist_lower_bound().
+    value_type bound = detail::_dist_lower_bound(
+      ax1, ax2, ay1, ay2, bx1, bx2, by1, by2);
+    promoted_ = !far_ && !(8 * eps * (scale / factor)
+                           <= tolerance * bound);
+    if (defer || simd::stdx::none_of(promoted_)) return;
+    for (std::size_t lane = 0; lane != size(); ++lane)
+      if (promoted_[lane])
+        promoted_dist_[lane] = static_cast<DataType>(expected_dist(
+          Rect<double>(ax1[lane], ax2[lane], ay1[lane], ay2[lane]),
+          Rect<double>(bx1[lane], bx2[lane], by1[lane], by2[lane])));
+  }
+
+  // The sum a + r without cancellation, see TwinRect::_sum().
+  static auto _sum(const value_type& a, const value_type& r,
+                   const value_type& bsq) -> value_type {
+    value_type result = a + r;
+    where(a < 0, result) = bsq / (r - a);
+    return result;
+  }
+
+  // Logarithm of (q + qrt) / (p + prt), masked to zero where x = 0.
+  // It is exactly the branch `x? ... : 0` in the scalar primitives.
+  static auto _xlog(const value_type& p, const value_type& q,
+                    const value_type& prt, const value_type& qrt,
+                    const value_type& x) -> value_type {
+    value_type xsq = x * x;
+    value_type result = simd::log(_sum(q, qrt, xsq) / _sum(p, prt, xsq));
+    where(x == 0, result) = 0;
+    return result;
+  }
+
+  // Logarithm of x + rt, masked to zero where the coefficient c = 0.
+  static auto _clog(const value_type& c, const value_type& rt,
+                    const value_type& x) -> value_type {
+    value_type result = simd::log(_sum(x, rt, c * c));
+    where(c == 0, result) = 0;
+    return result;
+  }
+
+  static auto f(const value_type& p, const value_type& q,
+                const value_type& x) -> value_type {
+    value_type xsq = x * x;
+    value_type psqs = p * p + xsq, qsqs = q * q + xsq;
+    value_type result = qsqs * simd::sqrt(qsqs) - psqs * simd::sqrt(psqs);
+    return result / 3;
+  }
+
+  static auto g(const value_type& p, const value_type& q,
+                const value_type& x) -> value_type {
+    value_type xsq = x * x;
+    value_type prt = simd::sqrt(p * p + xsq), qrt = simd::sqrt(q * q + xsq);
+    value_type result = q * qrt - p * prt
+        + xsq * _xlog(p, q, prt, qrt, x);
+    return result / 2;
+  }
+
+  auto dens(const value_type& x) const -> value_type {
+    value_type result = 0;
+    mask_type both = h1_ && h2_, none = !h1_ && !h2_;
+    mask_type either = !(both || none);
+    if (simd::stdx::any_of(both))
+      where(both, result) =
+          f(coord1[0], coord1[1], x)
+        - f(coord1[2], coord1[3], x)
+        - g(coord1[0], coord1[1], x) * coord1[0]
+        + g(coord1[1], coord1[2], x) * (coord1[1] - coord1[0])
+        + g(coord1[2], coord1[3], x) * coord1[3];
+    if (simd::stdx::any_of(none))
+      where(none, result) = simd::sqrt(x * x + delta2 * delta2);
+    if (simd::stdx::any_of(either))
+      where(either, result) = g(coord1[0], coord1[3], x);
+    return result;
+  }
+
+  static auto _idfint_g(const value_type& p, const value_type& q,
+                        const value_type& x) -> value_type {
+    value_type psq = p * p, qsq = q * q, xsq = x * x;
+    value_type prt = simd::sqrt(psq + xsq), qrt = simd::sqrt(qsq + xsq);
+    value_type result = 2 * x * (q * qrt - p * prt)
+                      + q * qsq * _clog(q, qrt, x)
+                      - p * psq * _clog(p, prt, x)
+                      + x * xsq * _xlog(p, q, prt, qrt, x);
+    return result / 6;
+  }
+
+  static auto _idfint_xg(const value_type& p, const value_type& q,
+                         const value_type& x) -> value_type {
+    value_type psq = p * p, qsq = q * q, xsq = x * x;
+    value_type prt = simd::sqrt(psq + xsq), qrt = simd::sqrt(qsq + xsq);
+    value_type result = 2 * q * (5 * xsq + 2 * qsq) * qrt
+                      - 2 * p * (5 * xsq + 2 * psq) * prt
+                      + 6 * xsq * xsq * _xlog(p, q, prt, qrt, x);
+    return result / 48;
+  }
+
+  // Logarithm of a + r, where r = \sqrt{a ^ 2 + b ^ 2} and logb is the
+  // logarithm of |b|. Refer to TwinRect::_log_sum() for details.
+  static auto _log_sum(const value_type& a, const value_type& r,
+                       const value_type& logb) -> value_type {
+    value_type sum = a + r;
+    where(a < 0, sum) = r - a;
+    value_type result = simd::log(sum);
+    where(a < 0, result) = 2 * logb - result;
+    return result;
+  }
+
+  // The antiderivatives of dens(x) and x * dens(x) in each lane. Refer to
+  // TwinRect::_idfint_dens() for details.
+  // The square @xsq of @x is shared by the rows, see ColumnTerms.
+  auto _idfint_dens(const value_type& x, const value_type& xsq) const
+      -> std::pair<value_type, value_type> {
+    value_type d = 0, xd = 0;
+    mask_type both = h1_ && h2_, none = !h1_ && !h2_;
+    mask_type either = !(both || none);
+    if (simd::stdx::any_of(both)) {
+      std::array<value_type, 4> pf, pg, pxf, pxg, sum;
+      for (std::size_t k = 0; k != 4; ++k) {
+        const value_type& y = coord1[k];
+        value_type rsq = ysq[k] + xsq, rt = simd::sqrt(rsq);
+        value_type lx = _log_sum(x, rt, logy[k]);
+        where(y == 0, lx) = 0;
+        sum[k] = _sum(y, rt, xsq);
+        pf[k] = x * (2 * xsq + 5 * ysq[k]) * rt + 3 * ysq[k] * ysq[k] * lx;
+        pg[k] = 2 * x * y * rt + y * ysq[k] * lx;
+        pxf[k] = rsq * rsq * rt;
+        pxg[k] = 2 * y * (5 * xsq + 2 * ysq[k]) * rt;
+      }
+      std::array<value_type, 3> dg, dxg;
+      for (std::size_t k = 0; k != 3; ++k) {
+        value_type lr = simd::log(sum[k + 1] / sum[k]);
+        where(x == 0, lr) = 0;
+        dg[k] = pg[k + 1] - pg[k] + x * xsq * lr;
+        dxg[k] = pxg[k + 1] - pxg[k] + 6 * xsq * xsq * lr;
+      }
+      auto assemble = [this](const auto& pa, DataType sa,
+                             const auto& db, DataType sb) {
+        return ((pa[1] - pa[0]) - (pa[3] - pa[2])) / sa
+             + (db[1] * (coord1[1] - coord1[0])
+              - db[0] * coord1[0] + db[2] * coord1[3]) / sb;
+      };
+      where(both, d) = assemble(pf, 24, dg, 6);
+      where(both, xd) = assemble(pxf, 15, dxg, 48);
+    }
+    if (simd::stdx::any_of(none)) {
+      value_type dsq = delta2 * delta2, rsq = xsq + dsq;
+      value_type rt = simd::sqrt(rsq);
+      value_type lx = _log_sum(x, rt, logd);
+      where(delta2 == 0, lx) = 0;
+      where(none, d) = (x * rt + dsq * lx) / 2;
+      where(none, xd) = rsq * rt / 3;
+    }
+    if (simd::stdx::any_of(either)) {
+      where(either, d) = _idfint_g(coord1[0], coord1[3], x);
+      where(either, xd) = _idfint_xg(coord1[0], coord1[3], x);
+    }
+    return { d, xd };
+  }
+
+  // Whether the shapes are non-degenerated in each lane.
+  mask_type w1_, h1_, w2_, h2_;
+
+  // Whether the lane is far-field, and the far-field expansion.
+  mask_type far_;
+  value_type far_dist_, far_error_;
+
+  // Whether the lane is evaluated in double, see _promote().
+  mask_type promoted_ { false };
+  value_type promoted_dist_ = 0;
+
+  // Position information.
+  value_type delta1, delta2;
+
+  // Area information.
+  value_type factor;
+
+  // Image information.
+  std::array<value_type, 4> coord0, coord1;
+
+  // Squares of coord0, shared by all breakpoints in @coord1.
+  std::array<value_type, 4> xsq;
+
+  // Squares and logarithms of |coord1|, and the logarithm of |delta2|,
+  // shared by all breakpoints in @coord0.
+  std::array<value_type, 4> ysq, logy;
+  value_type logd;
+};
+
+template<class DataType>
+requires floating<DataType>
+void expected_dist(const RectSpan<DataType>& lhs,
+                   const RectSpan<DataType>& rhs,
+                   std::span<DataType> result,
+                   DataType tolerance = promotion_tolerance<DataType>);
+
+namespace detail {
+
+// Rerun the pairs flagged in @promoted by the batch in double, and round
+// the expected distances back into @result.
+template<class DataType>
+requires floating<DataType>
+void _expected_dist_promoted(const RectSpan<DataType>& lhs,
+                             const RectSpan<DataType>& rhs,
+                             std::span<DataType> result,
+                             const std::vector<unsigned char>& promoted) {
+  std::vector<std::size_t> index;
+  for (std::size_t i = 0; i != promoted.size(); ++i)
+    if (promoted[i]) index.push_back(i);
+  if (index.empty()) return;
+  const std::size_t count = index.size();
+  std::vector<double> coords(count * 8), dist(count);
+  const std::span<const DataType> columns[] = {
+    lhs.x1, lhs.x2, lhs.y1, lhs.y2, rhs.x1, rhs.x2, rhs.y1, rhs.y2
+  };
+  for (std::size_t k = 0; k != 8; ++k)
+    for (std::size_t j = 0; j != count; ++j)
+      coords[k * count + j] = columns[k][index[j]];
+  auto column = [&](std::size_t k) {
+    return std::span<const double>(coords).subspan(k * count, count);
+  };
+  expected_dist(RectSpan<double> { column(0), column(1),
+                                   column(2), column(3) },
+                RectSpan<double> { column(4), column(5),
+                                   column(6), column(7) },
+                std::span<double>(dist));
+  for (std::size_t j = 0; j != count; ++j)
+    result[index[j]] = static_cast<DataType>(dist[j]);
+}
+
+} // namespace detail
+
+/**
+ * @brief Calculate the expected distances between pairs of rectangles
+ *  stored as structure-of-arrays, i.e. @result[i] is the expected distance
+ *  between the i-th rectangles of @lhs and @rhs. The pairs are packed into
+ *  simd lanes and evaluated by @TwinRectSimd, and in precisions narrower
+ *  than double, the promoted pairs are gathered and rerun in double.
+ *  The lanes are the ones of the instruction set of the including program,
+ *  i.e. only two doubles of SSE2 on x86-64 by default, which is no faster
+ *  than the scalar loop. Compile with -march (FIOCCA_NATIVE_ARCH), or
+ *  call dispatch::expected_dist() of libfiocca, which selects the widest
+ *  instruction set of the host at load time.
+ * @param lhs the lefthand side rectangles.
+ * @param rhs the righthand side rectangles, of the same size as @lhs.
+ * @param result the output buffer, of the same size as @lhs.
+ * @param tolerance the relative tolerance of the closed representation
+ *  in precisions narrower than double, which defaults to 1e-3, the accuracy
+ *  of float results, see promotion_tolerance.
+ */
+template<class DataType>
+requires floating<DataType>
+void expected_dist(const RectSpan<DataType>& lhs,
+                   const RectSpan<DataType>& rhs,
+                   std::span<DataType> result,
+                   DataType tolerance) {
+  using twin_type = TwinRectSimd<DataType>;
+  using value_type = typename twin_type::value_type;
+  constexpr std::size_t width = twin_type::size();
+  const std::size_t size = lhs.size();
+  const std::size_t body = size - size % width;
+  constexpr auto aligned = simd::stdx::element_aligned;
+
+  // The promoted pairs are deferred and rerun by the batch in double, so
+  // that they still run in simd lanes, see _expected_dist_promoted().
+  constexpr bool promotes = sizeof(DataType) < sizeof(double);
+  std::vector<unsigned char> promoted(promotes? size : 0);
+  auto flag = [&](const twin_type& twin_rect, std::size_t i) {
+    if constexpr (promotes)
+      if (simd::stdx::any_of(twin_rect.promoted()))
+        for (std::size_t lane = 0; lane != width && i + lane < size; ++lane)
+          promoted[i + lane] = twin_rect.promoted()[lane];
+  };
+
+#pragma omp parallel for
+  for (std::size_t i = 0; i < body; i += width) {
+    twin_type twin_rect(
+      value_type(&lhs.x1[i], aligned), value_type(&lhs.x2[i], aligned),
+      value_type(&lhs.y1[i], aligned), value_type(&lhs.y2[i], aligned),
+      value_type(&rhs.x1[i], aligned), value_type(&rhs.x2[i], aligned),
+      value_type(&rhs.y1[i], aligned), value_type(&rhs.y2[i], aligned),
+      promotes, tolerance);
+    twin_rect.dist().copy_to(&result[i], aligned);
+    flag(twin_rect, i);
+  }
+
+  // The remaining pairs are padded with unit squares to fill a vector.
+  if (body != size) {
+    auto tail = [&](std::span<const DataType> coords, DataType pad) {
+      return value_type([&](auto lane) {
+        return body + lane < size ? coords[body + lane] : pad;
+      });
+    };
+    twin_type twin_rect(
+      tail(lhs.x1, 0), tail(lhs.x2, 1), tail(lhs.y1, 0), tail(lhs.y2, 1),
+      tail(rhs.x1, 0), tail(rhs.x2, 1), tail(rhs.y1, 0), tail(rhs.y2, 1),
+      promotes, tolerance);
+    value_type dist = twin_rect.dist();
+    for (std::size_t lane = 0; body + lane < size; ++lane)
+      result[body + lane] = dist[lane];
+    flag(twin_rect, body);
+  }
+  if constexpr (promotes)
+    detail::_expected_dist_promoted(lhs, rhs, result, promoted);
+}
+
+namespace detail {
+
+// Data-parallel counterpart of sgn(y) * log((|y| + r) / |x|) in the point
+// to rectangle closed representation, masked to zero where x = 0.
+template<class Simd>
+requires simd::vectorized<Simd>
+auto _signed_log(const Simd& x, const Simd& y, const Simd& r) -> Simd {
+  Simd result = simd::log((simd::stdx::abs(y) + r) / simd::stdx::abs(x));
+  where(y < 0, result) = -result;
+  where(x == 0, result) = 0;
+  return result;
+}
+
+// Data-parallel counterpart of detail::_idfint_line().
+template<class Simd>
+requires simd::vectorized<Simd>
+auto _idfint_line(const Simd& x, const Simd& y) -> Simd {
+  Simd r = simd::sqrt(x * x + y * y);
+  return (y * r + x * x * _signed_log(x, y, r)) / 2;
+}
+
+// Data-parallel counterpart of detail::_idfint_rect().
+template<class Simd>
+requires simd::vectorized<Simd>
+auto _idfint_rect(const Simd& x, const Simd& y) -> Simd {
+  Simd r = simd::sqrt(x * x + y * y);
+  return (2 * x * y * r + x * x * x * _signed_log(x, y, r)
+                        + y * y * y * _signed_log(y, x, r)) / 6;
+}
+
+} // namespace detail
+
+/**
+ * @brief Calculate the expected distances between many fixed points and a
+ *  point randomly selected from one rectangle, i.e. @result[i] is the
+ *  expected distance between the i-th point of @points and @rect. All
+ *  terms depending only on the rectangle, including the degeneracy case,
+ *  are hoisted out of the loop, and the points are packed into simd lanes.
+ * @param points the fixed points.
+ * @param rect the rectangle.
+ * @param result the output buffer, of the same size as @points.
+ */
+template<class DataType>
+requires floating<DataType>
+void expected_dist(const PointSpan<DataType>& points,
+                   const Rect<DataType>& rect,
+                   std::span<DataType> result) {
+  using value_type = simd::native_t<DataType>;
+  constexpr std::size_t width = value_type::size();
+  constexpr auto aligned = simd::stdx::element_aligned;
+  const std::size_t size = points.size();
+  const std::size_t body = size - size % width;
+  const value_type x1(rect.x1()), x2(rect.x2());
+  const value_type y1(rect.y1()), y2(rect.y2());
+  auto [ w, h ] = rect.shape();
+
+  auto evaluate = [&](auto&& kernel) {
+#pragma omp parallel for
+    for (std::size_t i = 0; i < body; i += width)
+      kernel(value_type(&points.x[i], aligned),
+             value_type(&points.y[i], aligned)).copy_to(&result[i], aligned);
+    if (body == size) return;
+    auto tail = [&](std::span<const DataType> coords) {
+      return value_type([&](auto lane) {
+        return body + lane < size ? coords[body + lane] : 0;
+      });
+    };
+    value_type dist = kernel(tail(points.x), tail(points.y));
+    for (std::size_t lane = 0; body + lane < size; ++lane)
+      result[body + lane] = dist[lane];
+  };
+
+  if (w && h) {
+    const value_type scale(1 / (w * h));
+    evaluate([&](const value_type& x, const value_type& y) {
+      value_type u0 = x1 - x, u1 = x2 - x, v0 = y1 - y, v1 = y2 - y;
+      return (detail::_idfint_rect(u1, v1) - detail::_idfint_rect(u0, v1)
+            - detail::_idfint_rect(u1, v0) + detail::_idfint_rect(u0, v0))
+            * scale;
+    });
+  } else if (w) { // Horizontal line.
+    const value_type scale(1 / w);
+    evaluate([&](const value_type& x, const value_type& y) {
+      value_type v0 = y1 - y;
+      return (detail::_idfint_line(v0, x2 - x)
+            - detail::_idfint_line(v0, x1 - x)) * scale;
+    });
+  } else if (h) { // Vertical line.
+    const value_type scale(1 / h);
+    evaluate([&](const value_type& x, const value_type& y) {
+      value_type u0 = x1 - x;
+      return (detail::_idfint_line(u0, y2 - y)
+            - detail::_idfint_line(u0, y1 - y)) * scale;
+    });
+  } else {
+    evaluate([&](const value_type& x, const value_type& y) {
+      value_type u0 = x1 - x, v0 = y1 - y;
+      return simd::sqrt(u0 * u0 + v0 * v0);
+    });
+  }
+}
+
+} // namespace fiocca
+
+#endif // FIOCCA_EXPECTED_DIST_BATCH_HPP_
@@ -0,0 +1,467 @@
+#ifndef FIOCCA_EXPECTED_DIST_BOX_HPP_
+#define FIOCCA_EXPECTED_DIST_BOX_HPP_
+
+#include <span>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <utility>
+#include <algorithm>
+#include "box.hpp"
+#include "expected_dist.hpp"
+
+namespace fiocca {
+
+/**
+ * @brief The step of the trapezoid rule in the logarithmic scale of the
+ *  Gaussian transform of boxes, see detail::_box_transform(). The error
+ *  decays exponentially in 1 / step, and the steps reach the relative
+ *  errors of about 1e-7, 1e-14 and 1e-18 respectively.
+ */
+template<class DataType>
+requires floating<DataType>
+inline constexpr DataType box_quad_step =
+    sizeof(DataType) == sizeof(float)? 0.4
+  : sizeof(DataType) == sizeof(double)? 0.2 : 0.15;
+
+namespace detail {
+
+// Binomial coefficients C(n, k) for n <= 40, i.e. up to the moments of the
+// series of AxisSpread.
+inline constexpr auto _box_binomials = [] {
+  std::array<std::array<double, 41>, 41> c { };
+  for (std::size_t n = 0; n != c.size(); ++n) {
+    c[n][0] = 1;
+    for (std::size_t k = 1; k <= n; ++k)
+      c[n][k] = c[n - 1][k - 1] + c[n - 1][k];
+  }
+  return c;
+}();
+
+/**
+ * @brief The difference u = v - a of two coordinates uniformly distributed
+ *  on [a1, a2] and [b1, b2] in one dimension, and its Gaussian transform
+ *      phi(t) = E exp(-t u ^ 2).
+ *  Let k = sqrt(t) and c = sqrt(pi) / (2 k). The density of u is the second
+ *  difference of ramps, so that
+ *      w1 w2 phi(t) = \sum_j e_j G(s_j),
+ *      G(s) = c |s| erf(k |s|) + exp(-t s ^ 2) / (2 t),
+ *  over the breakpoints s_j = b2 - a1, b2 - a2, b1 - a1, b1 - a2 with signs
+ *  e_j = +, -, -, +. Writing erf = 1 - erfc, the linear parts sum up to
+ *  2 c \sum_j e_j (s_j)_-, which only involves the overlap as in
+ *  _expected_abs(), and the rest decays. If t u_max ^ 2 < 1, the complement
+ *  is summed by the series
+ *      1 - phi(t) = \sum_n (-1) ^ {n + 1} t ^ n E[u ^ {2n}] / n!
+ *  instead, which never cancels. Degenerated intervals take lower orders.
+ *  The closed representation still cancels by eps / (t w1 w2) when a length
+ *  is small against 1 / k, where Hermite expansions over the narrow
+ *  intervals take over, see _hermite() and _hermite_edges().
+ */
+template<class DataType>
+requires floating<DataType>
+class AxisSpread {
+public:
+  AxisSpread(DataType a1, DataType a2, DataType b1, DataType b2)
+      : s_ { b2 - a1, b2 - a2, b1 - a1, b1 - a2 } {
+    // The mean and the wide interval relative to the midpoint of the narrow
+    // one are averages of breakpoints, which are exact for close intervals.
+    w1_ = a2 - a1, w2_ = b2 - b1, mean_ = (s_[1] + s_[2]) / 2;
+    umax_ = std::max(math::fabs(s_[0]), math::fabs(s_[3]));
+    gap_ = std::max<DataType>({ s_[3], -s_[0], 0 });
+    sep_ = 0, overlap_ = 0;
+    for (std::size_t j = 0; j != 4; ++j) {
+      if (DataType a = math::fabs(s_[j]); a && (!sep_ || a < sep_)) sep_ = a;
+      overlap_ += signs[j] * std::max<DataType>(mean_ < 0? s_[j] : -s_[j], 0);
+    }
+    narrow_ = std::min(w1_, w2_), wide_ = std::max(w1_, w2_);
+    lo_ = w1_ <= w2_? (s_[2] + s_[3]) / 2 : -(s_[0] + s_[2]) / 2;
+    hi_ = w1_ <= w2_? (s_[0] + s_[1]) / 2 : -(s_[1] + s_[3]) / 2;
+    if (!umax_) return;
+    // The moments are normalized by u_max, where u is the mean plus the
+    // difference of two centered uniform variables.
+    const auto& binom = _box_binomials;
+    DataType m = mean_ / umax_, p = w1_ / (2 * umax_), q = w2_ / (2 * umax_);
+    std::array<DataType, order + 1> pm, qm, mm;
+    auto& cm = cm_;
+    DataType pp = 1, qq = 1;
+    mm[0] = 1;
+    for (std::size_t j = 0; j <= order; ++j) {
+      pm[j] = pp / (2 * j + 1), qm[j] = qq / (2 * j + 1);
+      pp *= p * p, qq *= q * q;
+      if (j) mm[j] = mm[j - 1] * m * m;
+    }
+    for (std::size_t j = 0; j <= order; ++j) {
+      cm[j] = 0;
+      for (std::size_t i = 0; i <= j; ++i)
+        cm[j] += binom[2 * j][2 * i] * pm[i] * qm[j - i];
+    }
+    DataType factorial = 1;
+    for (std::size_t n = 1; n <= order; ++n) {
+      DataType moment = 0;
+      for (std::size_t j = 0; j <= n; ++j)
+        moment += binom[2 * n][2 * j] * mm[n - j] * cm[j];
+      factorial *= n;
+      coef_[n - 1] = (n % 2? 1 : -1) * moment / factorial;
+    }
+  }
+
+  // The Gaussian transform phi(t) and its complement 1 - phi(t).
+  auto transform(DataType t) const -> std::pair<DataType, DataType> {
+    if (!umax_) return { 1, 0 };
+    if (DataType z = t * umax_ * umax_; z < 1) {
+      // Fewer terms suffice for small z, where z ^ 5 / 5! < 1e-22 and
+      // z ^ 9 / 9! < 1e-23 respectively.
+      DataType psi = 0;
+      for (std::size_t n = z < 1e-4? 4 : z < 1e-2? 8 : order; n; --n)
+        psi = (psi + coef_[n - 1]) * z;
+      return { 1 - psi, psi };
+    }
+    // The intervals are disjoint, and phi <= exp(-t gap ^ 2) vanishes.
+    if (t * gap_ * gap_ > cutoff) return { 0, 1 };
+    DataType phi = _transform(t);
+    return { phi, 1 - phi };
+  }
+
+  // The coefficient of t ^ n in the series of 1 - phi(t), 1 <= n <= order.
+  auto series(std::size_t n) const -> DataType {
+    return umax_? coef_[n - 1] * std::pow(umax_ * umax_, n) : 0;
+  }
+
+  // The second moment E[u ^ 2].
+  auto second_moment() const {
+    return mean_ * mean_ + (w1_ * w1_ + w2_ * w2_) / 12;
+  }
+
+  /**
+   * @brief The asymptotic expansion phi(t) ~ c0 + c1 / k + c2 / k ^ 2 for
+   *  large t = k ^ 2, where the exponentials of the nonzero breakpoints
+   *  vanish, see remainder(). Only the overlap and the zero breakpoints
+   *  remain.
+   */
+  auto asymptote() const -> std::array<DataType, 3> {
+    if (!umax_) return { 1, 0, 0 };
+    if (w1_ && w2_) {
+      DataType zeros = 0;
+      for (std::size_t j = 0; j != 4; ++j) if (!s_[j]) zeros += signs[j];
+      return { 0, std::sqrt(pi) * overlap_ / (w1_ * w2_),
+               zeros / (2 * w1_ * w2_) };
+    }
+    if (!w1_ && !w2_) return { 0, 0, 0 };
+    auto sign = [](DataType x) -> DataType { return (x > 0) - (x < 0); };
+    DataType lo = w1_? s_[3] : s_[2], hi = s_[0];
+    return { 0, std::sqrt(pi) * (sign(hi) - sign(lo)) / (2 * (hi - lo)), 0 };
+  }
+
+  // An upper bound of the error of asymptote() at t, where each nonzero
+  // breakpoint s contributes at most exp(-t s ^ 2) / t to w1 w2 phi(t),
+  // since erfc(x) <= exp(-x ^ 2).
+  auto remainder(DataType t) const -> DataType {
+    if (!sep_) return 0;
+    DataType decay = std::exp(-t * sep_ * sep_);
+    if (w1_ && w2_) return 4 * decay / (t * w1_ * w2_);
+    if (w1_ || w2_) return std::sqrt(pi / t) * decay / (w1_ + w2_);
+    return decay;
+  }
+
+private:
+  static constexpr DataType pi = std::numbers::pi_v<DataType>;
+  // Signs of the breakpoints in the second difference.
+  static constexpr DataType signs[] = { 1, -1, -1, 1 };
+  // The exponent beyond which exp(-x) is negligible in 1 - phi.
+  static constexpr DataType cutoff =
+    -math::log(std::numeric_limits<DataType>::epsilon()) + 2;
+  // The order of the series, whose truncation error is below 1 / 21!.
+  static constexpr std::size_t order = 20;
+  // The lengths times k below which the Hermite expansions are taken, their
+  // maximal order, where (1 / 2) ^ n / n! < 1e-20, and the bound of terms
+  // ending the expansions.
+  static constexpr DataType thin = 0.5;
+  static constexpr std::size_t hermite_order = 15;
+  static constexpr DataType hermite_tolerance =
+    std::numeric_limits<DataType>::epsilon() / 16;
+
+  auto _transform(DataType t) const -> DataType {
+    DataType k = std::sqrt(t);
+    if (k * wide_ <= thin) return _hermite(k);
+    if (k * narrow_ <= thin) return _hermite_edges(k);
+    // Both lengths are at least thin / k, so that the cancellation of the
+    // closed representation is at most 4 eps. Since
+    // c |s| erfc(k |s|) <= exp(-t s ^ 2) / (2 t), erfc is skipped at the
+    // zero breakpoints and where both terms are negligible.
+    DataType c = std::sqrt(pi) / (2 * k);
+    const DataType tiny = std::numeric_limits<DataType>::epsilon()
+                        * w1_ * w2_ / 8;
+    DataType sum = 2 * c * overlap_;
+    for (std::size_t j = 0; j != 4; ++j) {
+      DataType a = math::fabs(s_[j]), e = std::exp(-t * a * a) / (2 * t);
+      sum += signs[j] * (a && e > tiny? e - c * a * std::erfc(k * a) : e);
+    }
+    return sum / (w1_ * w2_);
+  }
+
+  // Both lengths are below thin / k: the Hermite expansion
+  //     exp(-(x + h) ^ 2) = exp(-x ^ 2) \sum_n H_n(x) h ^ n / n!
+  // at x = k mean, averaged over h = k (u - mean), whose odd moments
+  // vanish. By Cramer's inequality and |h| <= k wide = r, the n-th even
+  // term is at most (2 r ^ 2) ^ n / n!, which ends the sum.
+  auto _hermite(DataType k) const -> DataType {
+    DataType x = k * mean_, z = k * k * umax_ * umax_;
+    DataType prev = 1, curr = 2 * x, sum = 1, power = 1, factorial = 1;
+    DataType bound = 1, ratio = 2 * k * wide_ * k * wide_;
+    for (std::size_t n = 1; n <= hermite_order; ++n) {
+      if ((bound *= ratio / n) < hermite_tolerance) break;
+      // H_{2n} from H_{2n - 2} and H_{2n - 1} by the recurrence.
+      DataType next = 2 * x * curr - 2 * (2 * n - 1) * prev;
+      power *= z, factorial *= (2 * n - 1) * (2 * n);
+      sum += next * cm_[n] * power / factorial;
+      prev = next, curr = 2 * x * next - 4 * n * curr;
+    }
+    return std::exp(-x * x) * sum;
+  }
+
+  // Only the narrow length is below thin / k: the closed representation
+  // over the wide interval relative to the midpoint of the narrow one,
+  // where erfc is taken on the side away from zero, plus the Taylor
+  // expansion over the narrow interval. The even derivatives are
+  //     -k ^ {2n - 1} [H_{2n - 1}(y) exp(-y ^ 2)]_{k lo}^{k hi} / wide,
+  // and the terms are bounded as in _hermite() with r = k narrow / 2.
+  auto _hermite_edges(DataType k) const -> DataType {
+    DataType c = std::sqrt(pi) / (2 * k), f;
+    if (lo_ >= 0) f = std::erfc(k * lo_) - std::erfc(k * hi_);
+    else if (hi_ <= 0) f = std::erfc(-k * hi_) - std::erfc(-k * lo_);
+    else f = std::erf(k * hi_) - std::erf(k * lo_);
+    f *= c;
+    if (!narrow_) return f / wide_;
+    DataType y[] = { k * lo_, k * hi_ }, prev[] = { 1, 1 }, curr[2], e[2];
+    for (std::size_t i = 0; i != 2; ++i)
+      curr[i] = 2 * y[i], e[i] = std::exp(-y[i] * y[i]);
+    DataType q = k * narrow_ / 2, power = 1, factorial = 1, sum = 0;
+    DataType bound = 1;
+    for (std::size_t n = 1; n <= hermite_order; ++n) {
+      if ((bound *= 2 * q * q / n) < hermite_tolerance) break;
+      // H_{2n - 1} and H_{2n - 2} are curr and prev respectively.
+      power *= q * q, factorial *= (2 * n - 1) * (2 * n);
+      sum += power / ((2 * n + 1) * factorial)
+           * (curr[1] * e[1] - curr[0] * e[0]);
+      for (std::size_t i = 0; i != 2; ++i) {
+        DataType even = 2 * y[i] * curr[i] - 2 * (2 * n - 1) * prev[i];
+        prev[i] = even, curr[i] = 2 * y[i] * even - 4 * n * curr[i];
+      }
+    }
+    return (f - sum / k) / wide_;
+  }
+
+  // Breakpoints, lengths of the intervals, the mean, the maximum and the
+  // minimum of |u|, the smallest nonzero breakpoint and the overlap term
+  // \sum_j e_j (s_j)_-.
+  std::array<DataType, 4> s_;
+  DataType w1_, w2_, mean_, umax_, gap_, sep_, overlap_;
+  // The narrow and the wide lengths, and the wide interval relative to the
+  // midpoint of the narrow one.
+  DataType narrow_, wide_, lo_, hi_;
+  // Even central moments E[(u - mean) ^ {2n}] normalized by u_max.
+  std::array<DataType, order + 1> cm_;
+  // Coefficients of the series of 1 - phi in t u_max ^ 2.
+  std::array<DataType, order> coef_;
+};
+
+/**
+ * @brief The expected distance between two boxes by the Gaussian transform
+ *      r = \int_0^\infty (1 - exp(-tau ^ 2 r ^ 2)) / tau ^ 2 dtau / sqrt(pi),
+ *  which factorizes over the independent dimensions into
+ *      E|X - Y| = \int_0^\infty (1 - phi_x phi_y phi_z) / tau ^ 2 dtau
+ *                 / sqrt(pi)
+ *  with the transforms of AxisSpread at t = tau ^ 2. The complement is
+ *  accumulated as psi_x + phi_x (psi_y + phi_y psi_z) without cancellation.
+ *  Substituting tau = exp(s) / rho for the root mean square rho of the
+ *  distance, the integrand decays exponentially at both ends, where the
+ *  trapezoid rule converges geometrically in the step. The sums beyond the
+ *  end points are geometric series, where the integrand is a polynomial of
+ *  exp(s) on the left by the series, and a polynomial of exp(-s) on the
+ *  right by the asymptotic expansions of AxisSpread.
+ */
+template<class DataType>
+requires floating<DataType>
+auto _box_transform(const Box<DataType>& lhs, const Box<DataType>& rhs)
+    -> DataType {
+  using limits = std::numeric_limits<DataType>;
+  const std::array<AxisSpread<DataType>, 3> axes {
+    AxisSpread<DataType>(lhs.x1(), lhs.x2(), rhs.x1(), rhs.x2()),
+    AxisSpread<DataType>(lhs.y1(), lhs.y2(), rhs.y1(), rhs.y2()),
+    AxisSpread<DataType>(lhs.z1(), lhs.z2(), rhs.z1(), rhs.z2())
+  };
+  DataType rho = 0;
+  for (const auto& axis : axes) rho += axis.second_moment();
+  if (!rho) return 0;
+  rho = std::sqrt(rho);
+
+  // The left end, beyond which 1 - phi_x phi_y phi_z is the series up to
+  // t ^ 3, and the relative error of the geometric tails is about exp(7 s).
+  const DataType eps = limits::epsilon();
+  const DataType s_lo = std::log(eps) / 7 - 1;
+  std::array<DataType, 4> head { 1 };
+  for (const auto& axis : axes)
+    for (std::size_t n = 3; n; --n)
+      for (std::size_t j = 1; j <= n; ++j)
+        head[n] -= axis.series(j) * head[n - j];
+  // The right end, beyond which the factors are polynomials of
+  // y = exp(-s) = 1 / (k rho) up to negligible exponentials.
+  DataType s_hi = 0;
+  for (; s_hi < -s_lo * 3; s_hi += 1) {
+    DataType t = std::exp(2 * s_hi) / (rho * rho), bound = 0;
+    for (const auto& axis : axes) bound += axis.remainder(t);
+    if (bound < eps) break;
+  }
+  // The polynomial 1 - phi_x phi_y phi_z in y on the right.
+  std::array<DataType, 7> poly { 1 };
+  for (std::size_t d = 0; d != 3; ++d) {
+    auto [ c0, c1, c2 ] = axes[d].asymptote();
+    for (std::size_t m = 2 * d + 3; m--; )
+      poly[m] = c0 * poly[m] + (m? c1 * rho * poly[m - 1] : 0)
+              + (m > 1? c2 * rho * rho * poly[m - 2] : 0);
+  }
+  for (auto& coef : poly) coef = -coef;
+  poly[0] += 1;
+
+  const DataType step = box_quad_step<DataType>;
+  const std::size_t n = std::ceil((s_hi - s_lo) / step);
+  // The integrand at tau = x / rho for x = exp(s).
+  auto integrand = [&](DataType x) {
+    DataType t = x * x / (rho * rho);
+    // The remaining dimensions are skipped once a factor vanishes.
+    DataType result = 0, phi = 1;
+    for (const auto& axis : axes) {
+      auto [ p, q ] = axis.transform(t);
+      result += phi * q, phi *= p;
+      if (!phi) break;
+    }
+    return result / x;
+  };
+  // The nodes are advanced by multiplication instead of exponentials.
+  const DataType ratio = std::exp(step);
+  DataType x = std::exp(s_lo), last = integrand(x), sum = 0;
+  // The nodes beyond the left end sum up t ^ n / x geometrically.
+  for (std::size_t n = 1; n != head.size(); ++n)
+    sum -= head[n] * std::pow(x / rho, 2 * n) / x
+         / std::expm1((2 * n - 1) * step);
+  for (std::size_t i = 1; i <= n; ++i)
+    sum += last, last = integrand(x *= ratio);
+  sum += last;
+  // The nodes beyond the right end sum up y ^ {m + 1} geometrically.
+  for (std::size_t m = 0; m != poly.size(); ++m)
+    sum += poly[m] * std::pow(1 / x, m + 1) / std::expm1((m + 1) * step);
+  return sum * step * rho / std::sqrt(std::numbers::pi_v<DataType>);
+}
+
+// The squared separation ratio of two boxes from their sizes and the
+// doubled offset between their centroids, see _separation_sq().
+template<class T>
+constexpr auto _box_separation_sq(const std::array<T, 3>& w1,
+                                  const std::array<T, 3>& w2,
+                                  const std::array<T, 3>& d) -> T {
+  T num = 0, den = 0;
+  for (std::size_t i = 0; i != 3; ++i)
+    num += (w1[i] + w2[i]) * (w1[i] + w2[i]), den += d[i] * d[i];
+  return num / den;
+}
+
+/**
+ * @brief The far-field expansion of the expected distance between boxes.
+ *  The expansion of _far_field() does not depend on the dimension, and the
+ *  fourth-order term is rewritten as
+ *      E[6 a ^ 2 |u| ^ 2 - 5 a ^ 4 - |u| ^ 4] / (8 R ^ 3),
+ *  whose moments follow from the independent components u_i of u and the
+ *  direction cosines n_i of the offset:
+ *      E[a ^ 4] = \sum_i n_i ^ 4 M_i4
+ *               + 6 \sum_{i < j} n_i ^ 2 n_j ^ 2 M_i2 M_j2,
+ *      E[a ^ 2 |u| ^ 2] = \sum_i n_i ^ 2 (M_i4 + M_i2 \sum_{j != i} M_j2),
+ *      E|u| ^ 4 = \sum_i M_i4 + 2 \sum_{i < j} M_i2 M_j2.
+ *  The truncation error is bounded as in _far_field().
+ * @param d the offset between the centroids.
+ */
+template<class T>
+constexpr auto _box_far_field(const std::array<T, 3>& w1,
+                              const std::array<T, 3>& w2,
+                              const std::array<T, 3>& d) -> T {
+  T rsq = d[0] * d[0] + d[1] * d[1] + d[2] * d[2], r = math::sqrt(rsq);
+  std::array<T, 3> m2, m4, n2;
+  T u2 = 0;
+  for (std::size_t i = 0; i != 3; ++i) {
+    auto [ p, q, _ ] = _far_moments(w1[i], w2[i]);
+    m2[i] = p, m4[i] = q, n2[i] = d[i] * d[i] / rsq, u2 += p;
+  }
+  T a2 = 0, a4 = 0, a2u2 = 0, u4 = 0;
+  for (std::size_t i = 0; i != 3; ++i) {
+    a2 += n2[i] * m2[i], u4 += m4[i];
+    a4 += n2[i] * n2[i] * m4[i];
+    a2u2 += n2[i] * (m4[i] + m2[i] * (u2 - m2[i]));
+    for (std::size_t j = i + 1; j != 3; ++j) {
+      a4 += 6 * n2[i] * n2[j] * m2[i] * m2[j];
+      u4 += 2 * m2[i] * m2[j];
+    }
+  }
+  return r + (u2 - a2 + (6 * a2u2 - 5 * a4 - u4) / (4 * rsq)) / (2 * r);
+}
+
+} // namespace detail
+
+/**
+ * @brief The separation ratio of two boxes, see the version of rectangles.
+ */
+template<class DataType>
+requires floating<DataType>
+constexpr auto separation_ratio(const Box<DataType>& lhs,
+                                const Box<DataType>& rhs) {
+  auto [ w1, h1, d1 ] = lhs.shape();
+  auto [ w2, h2, d2 ] = rhs.shape();
+  std::array<DataType, 3> d { rhs.x1() + rhs.x2() - lhs.x1() - lhs.x2(),
+                              rhs.y1() + rhs.y2() - lhs.y1() - lhs.y2(),
+                              rhs.z1() + rhs.z2() - lhs.z1() - lhs.z2() };
+  if (!d[0] && !d[1] && !d[2])
+    return std::numeric_limits<DataType>::infinity();
+  return math::sqrt(detail::_box_separation_sq<DataType>(
+    { w1, h1, d1 }, { w2, h2, d2 }, d));
+}
+
+/**
+ * @brief Calculate the expected distance between two boxes, i.e. E|X - Y|
+ *  where X and Y are uniformly distributed in @lhs and @rhs respectively.
+ *  There is no tractable closed form in three dimensions, and the distance
+ *  is reduced to a one-dimensional integral of closed-form factors, see
+ *  detail::_box_transform(). Boxes far apart take the far-field expansion
+ *  at the same threshold as rectangles, see far_field_ratio.
+ */
+template<class DataType>
+requires floating<DataType>
+auto expected_dist(const Box<DataType>& lhs, const Box<DataType>& rhs)
+    -> DataType {
+  if (separation_ratio(lhs, rhs) < far_field_ratio<DataType>) {
+    auto [ w1, h1, d1 ] = lhs.shape();
+    auto [ w2, h2, d2 ] = rhs.shape();
+    return detail::_box_far_field<DataType>(
+      { w1, h1, d1 }, { w2, h2, d2 },
+      { (rhs.x1() + rhs.x2() - lhs.x1() - lhs.x2()) / 2,
+        (rhs.y1() + rhs.y2() - lhs.y1() - lhs.y2()) / 2,
+        (rhs.z1() + rhs.z2() - lhs.z1() - lhs.z2()) / 2 });
+  }
+  return detail::_box_transform(lhs, rhs);
+}
+
+/**
+ * @brief Calculate the expected distances between pairs of boxes in
+ *  parallel, i.e. result[i] = E|lhs[i] - rhs[i]|.
+ */
+template<class DataType>
+requires floating<DataType>
+void expected_dist(std::span<const Box<DataType> > lhs,
+                   std::span<const Box<DataType> > rhs,
+                   std::span<DataType> result) {
+#pragma omp parallel for schedule(dynamic, 64)
+  for (std::size_t i = 0; i < lhs.size(); ++i)
+    result[i] = expected_dist(lhs[i], rhs[i]);
+}
+
+} // namespace fiocca
+
+#endif // FIOCCA_EXPECTED_DIST_BOX_HPP_
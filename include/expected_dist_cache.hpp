@@ -0,0 +1,219 @@
+#ifndef FIOCCA_EXPECTED_DIST_CACHE_HPP_
+#define FIOCCA_EXPECTED_DIST_CACHE_HPP_
+
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include "rect.hpp"
+#include "expected_dist.hpp"
+
+namespace fiocca {
+
+/**
+ * @brief The policies to match the shapes of two rectangle systems.
+ *  - exact: the shapes must be bitwise identical, and the cached values are
+ *    computed from the canonical pair of the shape (see @DistCache).
+ *  - quantized: the shapes are rounded to multiples of a quantum, and the
+ *    cached values are computed from the rounded shapes. Hence all systems
+ *    with the same rounded shape share exactly the same result.
+ */
+enum class CachePolicy { exact, quantized };
+
+/**
+ * @brief A bounded, thread-safe memoization cache of expected distances.
+ *  The expected distance of two rectangles only depends on the normalized
+ *  shape (w1, h1, w2, h2, delta1, delta2), i.e. the sizes of rectangles and
+ *  the offset between their bottom left corners, instead of the absolute
+ *  positions. The cache is keyed on this tuple.
+ *
+ *  The computation in floating point does depend on the absolute positions
+ *  though, e.g. through the far-field test and the promotion on
+ *  cancellation, and the shape is itself rounded from the coordinates. So
+ *  every value is computed from the canonical pair of its key, i.e. the
+ *  rectangles translated such that the bottom left corner of @lhs is at the
+ *  origin. All pairs with the same key then get the same value regardless
+ *  of the lookup order, which is the uncached value of the canonical pair
+ *  and agrees with that of the original pair up to rounding.
+ *
+ *  The entries are distributed into several shards, each protected by its
+ *  own mutex and evicted in least-recently-used order. The distance is
+ *  computed outside of the lock when a lookup misses. The capacity bounds
+ *  the total number of entries: each shard holds at most its share of the
+ *  capacity rounded up, and an insertion beyond the capacity evicts from
+ *  its own shard, or is skipped if that shard is empty.
+ */
+template<class DataType = double>
+requires floating<DataType>
+class DistCache {
+public:
+  using key_type = std::array<DataType, 6>;
+
+  /**
+   * @brief Construct an empty cache.
+   * @param capacity the maximal number of cached entries in total.
+   * @param policy the policy to match the shapes.
+   * @param quantum the resolution of the quantized policy. The policy falls
+   *  back to the exact one if the quantum is not positive.
+   */
+  explicit DistCache(std::size_t capacity = 1 << 16,
+                     CachePolicy policy = CachePolicy::exact,
+                     DataType quantum = 0)
+      : policy_(quantum > 0? policy : CachePolicy::exact),
+        quantum_(quantum), capacity_(capacity),
+        shard_capacity_((capacity + nshards - 1) / nshards),
+        shards_(std::make_unique<Shard[]>(nshards)) { }
+
+  /**
+   * @brief Look up the expected distance between two rectangles, and
+   *  compute it by @TwinRect if it is not cached yet.
+   */
+  auto operator()(const Rect<DataType>& lhs,
+                  const Rect<DataType>& rhs) -> DataType {
+    auto [ w1, h1 ] = lhs.shape();
+    auto [ w2, h2 ] = rhs.shape();
+    key_type key = {
+      _encode(w1), _encode(h1), _encode(w2), _encode(h2),
+      _encode(rhs.x1() - lhs.x1()), _encode(rhs.y1() - lhs.y1())
+    };
+    Shard& shard = shards_[Hash { }(key) % nshards];
+    {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      if (auto it = shard.index.find(key); it != shard.index.end()) {
+        // Move the entry to the front as the most recently used one.
+        shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        return it->second->second;
+      }
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    DataType result = _compute(key);
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.index.contains(key)) return result;
+    // Replace the least recently used entry of the shard if either the
+    // shard or the whole cache is full.
+    if (shard.entries.size() >= shard_capacity_ || !_reserve()) {
+      if (shard.entries.empty()) return result;
+      shard.index.erase(shard.entries.back().first);
+      shard.entries.pop_back();
+    }
+    shard.entries.emplace_front(key, result);
+    shard.index.emplace(key, shard.entries.begin());
+    return result;
+  }
+
+  // Statistics of lookups.
+  auto hits() const { return hits_.load(std::memory_order_relaxed); }
+  auto misses() const { return misses_.load(std::memory_order_relaxed); }
+
+  // The number of cached entries.
+  auto size() const {
+    std::size_t result = 0;
+    for (std::size_t i = 0; i != nshards; ++i) {
+      std::lock_guard<std::mutex> lock(shards_[i].mutex);
+      result += shards_[i].entries.size();
+    }
+    return result;
+  }
+
+  // Remove all entries and reset the statistics.
+  void clear() {
+    for (std::size_t i = 0; i != nshards; ++i) {
+      std::lock_guard<std::mutex> lock(shards_[i].mutex);
+      size_.fetch_sub(shards_[i].entries.size(), std::memory_order_relaxed);
+      shards_[i].entries.clear();
+      shards_[i].index.clear();
+    }
+    hits_ = 0, misses_ = 0;
+  }
+
+private:
+  // The number of shards, which should be larger than the number of
+  // threads in common cases to reduce contention.
+  static constexpr std::size_t nshards = 64;
+
+  // Mix the key components (splitmix64 finalizer).
+  struct Hash {
+    auto operator()(const key_type& key) const {
+      std::uint64_t result = 0;
+      for (auto component : key) {
+        std::uint64_t x = result ^ std::hash<DataType> { }(component);
+        x += 0x9e3779b97f4a7c15ull;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        result = x ^ (x >> 31);
+      }
+      return static_cast<std::size_t>(result);
+    }
+  };
+
+  struct Shard {
+    using entry_type = std::pair<key_type, DataType>;
+    mutable std::mutex mutex;
+    std::list<entry_type> entries;
+    std::unordered_map<
+      key_type, typename std::list<entry_type>::iterator, Hash> index;
+  };
+
+  // Reserve a slot for a new entry within the capacity.
+  auto _reserve() -> bool {
+    if (size_.fetch_add(1, std::memory_order_relaxed) < capacity_)
+      return true;
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  // Encode a component of the shape into the key. The quantized component
+  // is the (integral) number of quanta.
+  auto _encode(DataType x) const -> DataType {
+    if (policy_ == CachePolicy::quantized)
+      return std::round(x / quantum_);
+    // Positive and negative zeros are identical.
+    return x? x : 0;
+  }
+
+  // Compute the expected distance from the canonical pair of the (possibly
+  // quantized) shape.
+  auto _compute(const key_type& key) const -> DataType {
+    auto decode = [&](std::size_t i) {
+      return policy_ == CachePolicy::quantized? key[i] * quantum_ : key[i];
+    };
+    Rect<DataType> lhs(0, decode(0), 0, decode(1));
+    Rect<DataType> rhs(decode(4), decode(4) + decode(2),
+                       decode(5), decode(5) + decode(3));
+    return expected_dist(lhs, rhs);
+  }
+
+  // Cache settings.
+  CachePolicy policy_;
+  DataType quantum_;
+  std::size_t capacity_, shard_capacity_;
+
+  // The number of entries over all shards.
+  std::atomic<std::size_t> size_ = 0;
+
+  // Shards of entries.
+  std::unique_ptr<Shard[]> shards_;
+
+  // Statistics of lookups.
+  std::atomic<std::size_t> hits_ = 0, misses_ = 0;
+};
+
+/**
+ * @brief Calculate the expected distance between two rectangles through a
+ *  memoization cache. In the exact policy it returns the uncached value of
+ *  the pair translated to the canonical position, see @DistCache.
+ */
+template<class DataType>
+auto expected_dist(const Rect<DataType>& lhs, const Rect<DataType>& rhs,
+                   DistCache<DataType>& cache) {
+  return cache(lhs, rhs);
+}
+
+} // namespace fiocca
+
+#endif // FIOCCA_EXPECTED_DIST_CACHE_HPP_
@@ -0,0 +1,124 @@
+#ifndef FIOCCA_EXPECTED_DIST_DISPATCH_HPP_
+#define FIOCCA_EXPECTED_DIST_DISPATCH_HPP_
+
+#include <span>
+#include <type_traits>
+#include "rect.hpp"
+#include "kernel_table.hpp"
+#include "expected_dist_batch.hpp"
+
+namespace fiocca {
+
+/**
+ * The kernels compiled into the fiocca library for several instruction
+ * sets, SSE2, AVX2 and AVX-512 on x86 (or the generic one elsewhere). The
+ * widest one supported by the host is selected at load time from cpuid,
+ * unless the environment variable FIOCCA_ISA names another supported one.
+ * The functions mirror the header-only ones for float and double, which
+ * are compiled for the baseline instruction set of the including program.
+ */
+namespace dispatch {
+
+// The kernels of the active instruction set.
+auto kernels() -> const KernelTable&;
+
+auto active_isa() -> Isa;
+
+auto isa_name(Isa isa) -> const char*;
+
+// Whether the kernels of @isa are compiled and supported by the host.
+auto supported(Isa isa) -> bool;
+
+// Activate the kernels of @isa for all threads, if supported.
+auto select_isa(Isa isa) -> bool;
+
+template<class DataType>
+concept dispatched = std::same_as<DataType, float> ||
+                     std::same_as<DataType, double>;
+
+template<class DataType>
+requires dispatched<DataType>
+auto _kernels() -> const Kernels<DataType>& {
+  if constexpr (std::is_same_v<DataType, float>) return kernels().f32;
+  else return kernels().f64;
+}
+
+/**
+ * @brief Calculate the expected distance between two rectangles by the
+ *  active kernel, see fiocca::expected_dist(). In float, the result is
+ *  accurate to about @tolerance relatively, and the kernels of different
+ *  instruction sets may differ by up to twice as much, see
+ *  promotion_tolerance.
+ */
+template<class DataType>
+requires dispatched<DataType>
+auto expected_dist(const Rect<DataType>& lhs, const Rect<DataType>& rhs,
+                   DataType tolerance = promotion_tolerance<DataType>)
+    -> DataType {
+  const DataType coords[] = { lhs.x1(), lhs.x2(), lhs.y1(), lhs.y2(),
+                              rhs.x1(), rhs.x2(), rhs.y1(), rhs.y2() };
+  return _kernels<DataType>().dist(coords, tolerance);
+}
+
+/**
+ * @brief Calculate the expected distances between pairs of rectangles by
+ *  the active batch kernel, see the @RectSpan version of
+ *  fiocca::expected_dist(), with the same accuracy as the single pair.
+ */
+template<class DataType>
+requires dispatched<DataType>
+void expected_dist(const RectSpan<DataType>& lhs,
+                   const RectSpan<DataType>& rhs,
+                   std::span<DataType> result,
+                   DataType tolerance = promotion_tolerance<DataType>) {
+  const DataType* const columns[] = {
+    lhs.x1.data(), lhs.x2.data(), lhs.y1.data(), lhs.y2.data(),
+    rhs.x1.data(), rhs.x2.data(), rhs.y1.data(), rhs.y2.data()
+  };
+  _kernels<DataType>().dist_batch(columns, lhs.size(), result.data(),
+                                  tolerance);
+}
+
+// The integrand is called through its address as the context.
+template<class DataType, class Integrand>
+auto _trampoline(DataType x, void* context) -> DataType {
+  return (*static_cast<std::remove_reference_t<Integrand>*>(context))(x);
+}
+
+template<class Integrand>
+auto _context(Integrand& integrand) -> void* {
+  return const_cast<void*>(static_cast<const void*>(&integrand));
+}
+
+// The integrators of fiocca::integral by the active kernels.
+template<class DataType, class Integrand>
+requires dispatched<DataType> && integral::integrable<Integrand, DataType>
+auto trapezoid(Integrand&& integrand, DataType min, DataType max,
+               std::size_t ngrid = 1e+6) -> DataType {
+  return _kernels<DataType>().trapezoid(
+    _trampoline<DataType, Integrand>, _context(integrand), min, max, ngrid);
+}
+
+template<class DataType, class Integrand>
+requires dispatched<DataType> && integral::integrable<Integrand, DataType>
+auto simpson(Integrand&& integrand, DataType min, DataType max,
+             std::size_t ngrid = 1e+6) -> DataType {
+  return _kernels<DataType>().simpson(
+    _trampoline<DataType, Integrand>, _context(integrand), min, max, ngrid);
+}
+
+template<class DataType, class Integrand>
+requires dispatched<DataType> && integral::integrable<Integrand, DataType>
+auto romberg(Integrand&& integrand, DataType min, DataType max,
+             DataType accuracy = static_cast<DataType>(1e-11),
+             std::size_t max_steps = 32) -> DataType {
+  return _kernels<DataType>().romberg(
+    _trampoline<DataType, Integrand>, _context(integrand),
+    min, max, accuracy, max_steps);
+}
+
+} // namespace dispatch
+
+} // namespace fiocca
+
+#endif // FIOCCA_EXPECTED_DIST_DISPATCH_HPP_
@@ -0,0 +1,270 @@
+#ifndef FIOCCA_EXPECTED_DIST_FILE_HPP_
+#define FIOCCA_EXPECTED_DIST_FILE_HPP_
+
+#include <span>
+#include <array>
+#include <vector>
+#include <string>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+#include <bit>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "expected_dist_batch.hpp"
+
+namespace fiocca {
+
+/**
+ * @brief The binary layout of batch files, little-endian throughout. Each
+ *  file starts with a header of 32 bytes:
+ *      offset  0: char[8]  magic, "FIOCCARP" for pairs of rectangles and
+ *                          "FIOCCAED" for expected distances,
+ *      offset  8: uint32   version, currently 1,
+ *      offset 12: uint32   dtype, 1 for float32 and 2 for float64,
+ *      offset 16: uint64   count, the number of pairs,
+ *      offset 24: uint64   reserved, zero.
+ *  A file of pairs then stores eight columns of count coordinates each, in
+ *  the order lhs.x1, lhs.x2, lhs.y1, lhs.y2, rhs.x1, rhs.x2, rhs.y1, rhs.y2,
+ *  so that any window of pairs maps to @RectSpan without copying. A file of
+ *  expected distances stores a single column of count values.
+ */
+struct BatchHeader {
+  enum dtype_t : std::uint32_t { float32 = 1, float64 = 2 };
+  static constexpr char pairs_magic[] = "FIOCCARP";
+  static constexpr char dists_magic[] = "FIOCCAED";
+  static constexpr std::uint32_t current_version = 1;
+
+  // The data type code of DataType.
+  template<class DataType>
+  requires floating<DataType>
+  static constexpr auto dtype_of() -> dtype_t {
+    static_assert(sizeof(DataType) == 4 || sizeof(DataType) == 8,
+                  "only float32 and float64 are supported in batch files.");
+    return sizeof(DataType) == 4? float32 : float64;
+  }
+
+  // The size of each value in bytes.
+  constexpr auto value_size() const -> std::size_t {
+    return dtype == float32? 4 : 8;
+  }
+
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t dtype;
+  std::uint64_t count;
+  std::uint64_t reserved;
+};
+static_assert(sizeof(BatchHeader) == 32);
+
+namespace detail {
+
+[[noreturn]] inline void _throw_errno(const std::string& what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+// The header is copied as is, since the layout is the native one on
+// little-endian hosts.
+inline void _check_endian() {
+  if constexpr (std::endian::native != std::endian::little)
+    throw std::runtime_error("batch files require a little-endian host.");
+}
+
+/**
+ * @brief A file descriptor closed on destruction, and the mapped windows
+ *  of the file. Windows may start at any offset, which is aligned down to
+ *  the page size internally.
+ */
+class MappedFile {
+public:
+  class Window {
+  public:
+    Window(void* base, std::size_t length, std::size_t shift)
+        : base_(base), length_(length), shift_(shift) { }
+    Window(const Window&) = delete;
+    Window(Window&& other) noexcept
+        : base_(std::exchange(other.base_, nullptr)),
+          length_(other.length_), shift_(other.shift_) { }
+    ~Window() { if (base_) ::munmap(base_, length_); }
+
+    template<class DataType>
+    auto data() const -> DataType* {
+      return reinterpret_cast<DataType*>(static_cast<char*>(base_) + shift_);
+    }
+
+  private:
+    void* base_;
+    std::size_t length_, shift_;
+  };
+
+  MappedFile(const std::string& path, bool writable)
+      : path_(path), writable_(writable) {
+    fd_ = ::open(path.c_str(), writable? O_RDWR | O_CREAT : O_RDONLY, 0644);
+    if (fd_ < 0) _throw_errno("cannot open " + path);
+  }
+  MappedFile(const MappedFile&) = delete;
+  ~MappedFile() { ::close(fd_); }
+
+  auto size() const -> std::size_t {
+    struct stat st;
+    if (::fstat(fd_, &st)) _throw_errno("cannot stat " + path_);
+    return st.st_size;
+  }
+
+  // Whether @path names the same file, e.g. through another link.
+  auto is(const std::string& path) const -> bool {
+    struct stat lhs, rhs;
+    if (::fstat(fd_, &lhs)) _throw_errno("cannot stat " + path_);
+    return !::stat(path.c_str(), &rhs) &&
+           lhs.st_dev == rhs.st_dev && lhs.st_ino == rhs.st_ino;
+  }
+
+  void resize(std::size_t size) {
+    if (::ftruncate(fd_, size)) _throw_errno("cannot resize " + path_);
+  }
+
+  // Map [offset, offset + length), where the pages are read sequentially
+  // and released on destruction of the window.
+  auto map(std::size_t offset, std::size_t length) const -> Window {
+    static const std::size_t page = ::sysconf(_SC_PAGESIZE);
+    std::size_t base = offset / page * page, shift = offset - base;
+    int prot = PROT_READ | (writable_? PROT_WRITE : 0);
+    void* ptr = ::mmap(nullptr, length + shift, prot, MAP_SHARED, fd_, base);
+    if (ptr == MAP_FAILED) _throw_errno("cannot map " + path_);
+    ::madvise(ptr, length + shift, MADV_SEQUENTIAL);
+    return Window(ptr, length + shift, shift);
+  }
+
+  auto read_header() const -> BatchHeader {
+    BatchHeader header;
+    if (size() < sizeof(header) ||
+        ::pread(fd_, &header, sizeof(header), 0) != ssize_t(sizeof(header)))
+      throw std::runtime_error(path_ + " is too short for a batch file.");
+    return header;
+  }
+
+  void write_header(const BatchHeader& header) {
+    if (::pwrite(fd_, &header, sizeof(header), 0) != ssize_t(sizeof(header)))
+      _throw_errno("cannot write " + path_);
+  }
+
+private:
+  std::string path_;
+  bool writable_;
+  int fd_;
+};
+
+// Validate the header of a file of pairs against its size.
+inline auto _read_pairs_header(const MappedFile& file,
+                               const std::string& path) -> BatchHeader {
+  BatchHeader header = file.read_header();
+  if (std::memcmp(header.magic, BatchHeader::pairs_magic, 8))
+    throw std::runtime_error(path + " is not a file of pairs.");
+  if (header.version != BatchHeader::current_version)
+    throw std::runtime_error(path + " has an unsupported version.");
+  if (header.dtype != BatchHeader::float32 &&
+      header.dtype != BatchHeader::float64)
+    throw std::runtime_error(path + " has an unsupported dtype.");
+  // Bound the count by division, since a forged count would overflow the
+  // size of the columns.
+  const std::size_t pair_size = 8 * header.value_size();
+  if (header.count > (file.size() - sizeof(header)) / pair_size)
+    throw std::runtime_error(path + " is truncated.");
+  return header;
+}
+
+template<class DataType>
+requires floating<DataType>
+auto _expected_dist_file(const MappedFile& input, MappedFile& output,
+                         std::size_t count, std::size_t window) {
+  constexpr std::size_t size = sizeof(DataType);
+  BatchHeader header { { }, BatchHeader::current_version,
+                       BatchHeader::dtype_of<DataType>(), count, 0 };
+  std::memcpy(header.magic, BatchHeader::dists_magic, 8);
+  output.resize(sizeof(header) + count * size);
+  output.write_header(header);
+
+  // Each window maps the eight input columns and the output column of the
+  // same range of pairs, and evaluates them by the batch kernel.
+  for (std::size_t begin = 0; begin < count; begin += window) {
+    const std::size_t length = std::min(window, count - begin);
+    std::array<std::span<const DataType>, 8> columns;
+    std::vector<MappedFile::Window> windows;
+    windows.reserve(9);
+    for (std::size_t k = 0; k != 8; ++k) {
+      windows.push_back(input.map(
+        sizeof(header) + (k * count + begin) * size, length * size));
+      columns[k] = { windows.back().data<const DataType>(), length };
+    }
+    auto& result = windows.emplace_back(
+      output.map(sizeof(header) + begin * size, length * size));
+    expected_dist(RectSpan<DataType> { columns[0], columns[1],
+                                       columns[2], columns[3] },
+                  RectSpan<DataType> { columns[4], columns[5],
+                                       columns[6], columns[7] },
+                  std::span<DataType>(result.data<DataType>(),
+                                      length));
+  }
+}
+
+} // namespace detail
+
+/**
+ * @brief Calculate the expected distances of all pairs in a batch file and
+ *  write them to another batch file, see @BatchHeader for the layout. The
+ *  files are memory-mapped in windows of @window pairs, so that files
+ *  larger than the memory are streamed through, and each window runs the
+ *  parallel batch kernel of its dtype. The input is validated before the
+ *  output is created, and the output must not be the input file.
+ * @throw std::runtime_error or std::system_error if a file is malformed or
+ *  cannot be accessed, or if both are the same file.
+ * @return the number of pairs.
+ */
+inline auto expected_dist_file(const std::string& input,
+                               const std::string& output,
+                               std::size_t window = 1 << 20) -> std::size_t {
+  detail::_check_endian();
+  detail::MappedFile in(input, false);
+  BatchHeader header = detail::_read_pairs_header(in, input);
+  if (in.is(output))
+    throw std::runtime_error(output + " is the same file as the input.");
+  detail::MappedFile out(output, true);
+  window = std::max<std::size_t>(window, 1);
+  if (header.dtype == BatchHeader::float32)
+    detail::_expected_dist_file<float>(in, out, header.count, window);
+  else detail::_expected_dist_file<double>(in, out, header.count, window);
+  return header.count;
+}
+
+/**
+ * @brief Write pairs of rectangles to a batch file in the layout of
+ *  @BatchHeader, e.g. as the input of expected_dist_file().
+ */
+template<class DataType>
+requires floating<DataType>
+void write_pairs_file(const std::string& path,
+                      const RectSpan<DataType>& lhs,
+                      const RectSpan<DataType>& rhs) {
+  detail::_check_endian();
+  BatchHeader header { { }, BatchHeader::current_version,
+                       BatchHeader::dtype_of<DataType>(), lhs.size(), 0 };
+  std::memcpy(header.magic, BatchHeader::pairs_magic, 8);
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  for (auto column : { lhs.x1, lhs.x2, lhs.y1, lhs.y2,
+                       rhs.x1, rhs.x2, rhs.y1, rhs.y2 })
+    file.write(reinterpret_cast<const char*>(column.data()),
+               lhs.size() * sizeof(DataType));
+  if (!file) throw std::runtime_error("cannot write " + path);
+}
+
+} // namespace fiocca
+
+#endif // FIOCCA_EXPECTED_DIST_FILE_HPP_
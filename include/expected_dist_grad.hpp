@@ -0,0 +1,58 @@
+#ifndef FIOCCA_EXPECTED_DIST_GRAD_HPP_
+#define FIOCCA_EXPECTED_DIST_GRAD_HPP_
+
+#include <span>
+#include <array>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include "rect.hpp"
+#include "expected_dist.hpp"
+
+namespace fiocca {
+
+/**
+ * @brief Evaluate the weighted sum of expected distances over an edge list
+ *  of rectangles, i.e. the objective \sum_e w_e E|R_i - R_j| of placement
+ *  problems, together with its gradient with respect to all coordinates.
+ *  The edges are evaluated in parallel by expected_dist_grad(), and the
+ *  partials are accumulated in the order of edges afterwards, so that the
+ *  result does not depend on the number of threads.
+ * @param rects the rectangles.
+ * @param edges the pairs of indices (i, j) into @rects.
+ * @param weights the weights of edges, or empty for unit weights.
+ * @param grad the output buffer of the same size as @rects, where grad[i]
+ *  is overwritten by the partials with respect to (x1, x2, y1, y2) of the
+ *  i-th rectangle.
+ * @return the weighted sum of expected distances.
+ */
+template<class DataType>
+requires floating<DataType>
+auto expected_dist_grad(
+    std::span<const Rect<DataType> > rects,
+    std::span<const std::pair<std::size_t, std::size_t> > edges,
+    std::span<const DataType> weights,
+    std::span<std::array<DataType, 4> > grad) -> DataType {
+  std::vector<DistGrad<DataType> > partials(edges.size());
+#pragma omp parallel for
+  for (std::size_t e = 0; e < edges.size(); ++e)
+    partials[e] = expected_dist_grad(
+      rects[edges[e].first], rects[edges[e].second]);
+
+  DataType result = 0;
+  std::ranges::fill(grad, std::array<DataType, 4> { });
+  for (std::size_t e = 0; e != edges.size(); ++e) {
+    DataType weight = weights.empty()? 1 : weights[e];
+    const auto& [ i, j ] = edges[e];
+    result += weight * partials[e].value;
+    for (std::size_t k = 0; k != 4; ++k) {
+      grad[i][k] += weight * partials[e].lhs[k];
+      grad[j][k] += weight * partials[e].rhs[k];
+    }
+  }
+  return result;
+}
+
+} // namespace fiocca
+
+#endif // FIOCCA_EXPECTED_DIST_GRAD_HPP_
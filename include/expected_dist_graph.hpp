@@ -0,0 +1,178 @@
+#ifndef FIOCCA_EXPECTED_DIST_GRAPH_HPP_
+#define FIOCCA_EXPECTED_DIST_GRAPH_HPP_
+
+#include <span>
+#include <vector>
+#include <ranges>
+#include <numeric>
+#include <utility>
+#include "rect.hpp"
+#include "expected_dist.hpp"
+
+namespace fiocca {
+
+/**
+ * @brief An incremental evaluator of the objective of a weighted graph of
+ *  rectangles, i.e. \sum_e w_e E|R_i - R_j| over the edges e = (i, j).
+ *
+ *  The expected distance of each edge is stored. A move replaces a few
+ *  rectangles, and only the edges incident to them are marked dirty and
+ *  recomputed, so that a move costs O(degree) instead of O(E). The moves
+ *  are two-phased for accept/reject decisions: propose() evaluates the
+ *  change of the objective without committing it, and accept() or reject()
+ *  settles the last proposal.
+ */
+template<class DataType = double>
+requires floating<DataType>
+class DistGraph {
+public:
+  using edge_type = std::pair<std::size_t, std::size_t>;
+  using move_type = std::pair<std::size_t, Rect<DataType> >;
+
+  /**
+   * @brief Construct the graph and evaluate all edges.
+   * @param rects the range of @Rect<DataType> objects, i.e. the nodes.
+   * @param edges the pairs of indices (i, j) into @rects.
+   * @param weights the weights of edges, or empty for unit weights.
+   */
+  template<std::ranges::input_range Range>
+  requires std::same_as<std::ranges::range_value_t<Range>, Rect<DataType> >
+  DistGraph(Range&& rects, std::span<const edge_type> edges,
+            std::span<const DataType> weights = { })
+      : rects_(std::ranges::begin(rects), std::ranges::end(rects)),
+        next_(rects_.size()), moved_(rects_.size(), 0),
+        edges_(edges.begin(), edges.end()),
+        weights_(weights.begin(), weights.end()),
+        values_(edges.size()), stamps_(edges.size(), 0) {
+    if (weights_.empty()) weights_.assign(edges_.size(), 1);
+    // The incident edges of each rectangle in the compressed sparse row
+    // format, where a self loop is listed once.
+    offsets_.assign(rects_.size() + 1, 0);
+    for (auto [ i, j ] : edges_) {
+      ++offsets_[i + 1];
+      if (j != i) ++offsets_[j + 1];
+    }
+    std::partial_sum(offsets_.begin(), offsets_.end(), offsets_.begin());
+    incident_.resize(offsets_.back());
+    std::vector<std::size_t> cursor(offsets_.begin(), offsets_.end() - 1);
+    for (std::size_t e = 0; e != edges_.size(); ++e) {
+      auto [ i, j ] = edges_[e];
+      incident_[cursor[i]++] = e;
+      if (j != i) incident_[cursor[j]++] = e;
+    }
+    recompute();
+  }
+
+  // The number of rectangles and edges.
+  auto size() const { return rects_.size(); }
+  auto num_edges() const { return edges_.size(); }
+
+  // The committed rectangles and the expected distance of each edge.
+  auto rects() const { return std::span<const Rect<DataType> >(rects_); }
+  auto values() const { return std::span<const DataType>(values_); }
+
+  // The committed objective.
+  auto objective() const { return objective_; }
+
+  /**
+   * @brief Evaluate all edges and the objective from scratch, which also
+   *  removes the rounding errors accumulated by the accepted deltas. The
+   *  pending proposal is rejected.
+   */
+  auto recompute() -> DataType {
+    reject();
+#pragma omp parallel for
+    for (std::size_t e = 0; e < edges_.size(); ++e)
+      values_[e] = expected_dist(rects_[edges_[e].first],
+                                 rects_[edges_[e].second]);
+    objective_ = 0;
+    for (std::size_t e = 0; e != edges_.size(); ++e)
+      objective_ += weights_[e] * values_[e];
+    return objective_;
+  }
+
+  /**
+   * @brief Propose to move some rectangles, and evaluate the change of the
+   *  objective without committing it. The dirty edges are recomputed in
+   *  parallel if there are many of them. A former pending proposal is
+   *  rejected, and a rectangle moved several times takes the last move.
+   * @param moves the pairs of indices and new rectangles.
+   * @return the change of the objective if the proposal is accepted.
+   */
+  auto propose(std::span<const move_type> moves) -> DataType {
+    reject();
+    for (const auto& [ i, rect ] : moves) {
+      if (moved_[i] != epoch_) moved_[i] = epoch_, moves_.push_back(i);
+      next_[i] = rect;
+    }
+    for (std::size_t i : moves_)
+      for (std::size_t k = offsets_[i]; k != offsets_[i + 1]; ++k)
+        if (std::size_t e = incident_[k]; stamps_[e] != epoch_)
+          stamps_[e] = epoch_, dirty_.push_back(e);
+
+    auto rect = [this](std::size_t i) -> const Rect<DataType>& {
+      return moved_[i] == epoch_? next_[i] : rects_[i];
+    };
+    pending_.resize(dirty_.size());
+#pragma omp parallel for if(dirty_.size() >= parallel_threshold)
+    for (std::size_t k = 0; k < dirty_.size(); ++k) {
+      auto [ i, j ] = edges_[dirty_[k]];
+      pending_[k] = expected_dist(rect(i), rect(j));
+    }
+    for (std::size_t k = 0; k != dirty_.size(); ++k)
+      delta_ += weights_[dirty_[k]] * (pending_[k] - values_[dirty_[k]]);
+    return delta_;
+  }
+
+  // Propose to move a single rectangle.
+  auto propose(std::size_t index, const Rect<DataType>& rect) -> DataType {
+    move_type move { index, rect };
+    return propose(std::span<const move_type>(&move, 1));
+  }
+
+  // Commit the pending proposal.
+  void accept() {
+    for (std::size_t i : moves_) rects_[i] = next_[i];
+    for (std::size_t k = 0; k != dirty_.size(); ++k)
+      values_[dirty_[k]] = pending_[k];
+    objective_ += delta_;
+    reject();
+  }
+
+  // Discard the pending proposal. The marks of the rectangles and edges
+  // are invalidated by advancing the epoch instead of clearing them.
+  void reject() {
+    moves_.clear(), dirty_.clear();
+    delta_ = 0, ++epoch_;
+  }
+
+private:
+  // The minimal number of dirty edges to be recomputed in parallel, below
+  // which the threads cost more than the edges.
+  static constexpr std::size_t parallel_threshold = 256;
+
+  // The committed rectangles, and the moved ones in the pending proposal,
+  // marked by the epoch of the proposal.
+  std::vector<Rect<DataType> > rects_, next_;
+  std::vector<std::size_t> moved_;
+
+  // Edges, their weights and the committed expected distances.
+  std::vector<edge_type> edges_;
+  std::vector<DataType> weights_, values_;
+  DataType objective_ = 0;
+
+  // The incident edges of rectangle i are incident_[offsets_[i], ...,
+  // offsets_[i + 1]).
+  std::vector<std::size_t> offsets_, incident_;
+
+  // The pending proposal: the moved rectangles, the dirty edges marked by
+  // the epoch, their new expected distances and the change of objective.
+  std::size_t epoch_ = 0;
+  std::vector<std::size_t> stamps_, moves_, dirty_;
+  std::vector<DataType> pending_;
+  DataType delta_ = 0;
+};
+
+} // namespace fiocca
+
+#endif // FIOCCA_EXPECTED_DIST_GRAPH_HPP_
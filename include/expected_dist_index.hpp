@@ -0,0 +1,229 @@
+#ifndef FIOCCA_EXPECTED_DIST_INDEX_HPP_
+#define FIOCCA_EXPECTED_DIST_INDEX_HPP_
+
+#include <span>
+#include <cmath>
+#include <queue>
+#include <limits>
+#include <vector>
+#include <ranges>
+#include <numeric>
+#include <utility>
+#include <algorithm>
+#include "rect.hpp"
+#include "expected_dist.hpp"
+
+namespace fiocca {
+
+/**
+ * @brief A spatial index answering the top-k queries of expected distances,
+ *  i.e. the k rectangles with the smallest expected distances to a query
+ *  rectangle, in ascending order.
+ *
+ *  The rectangles are organized in a bisection tree as @DistTree does, and
+ *  each node stores the bounding boxes of its rectangles and of their
+ *  centers. The expected distance E|X - Y| is bounded by
+ *      max(|E[X] - E[Y]|, d_min) <= E|X - Y| <= min(sqrt(E|X - Y|^2), d_max),
+ *  where the lower bound of centroids follows from Jensen's inequality for
+ *  the convex norm, the upper bound of the root mean square from Jensen's
+ *  inequality for the concave square root, and d_min and d_max are the
+ *  minimal and maximal distances between the rectangles. The lower bounds
+ *  extend to the nodes by the bounding boxes.
+ *
+ *  The nodes are visited in the ascending order of their lower bounds. The
+ *  k-th smallest upper bound seen so far is a threshold, beyond which the
+ *  nodes and rectangles are pruned, and only the surviving rectangles are
+ *  evaluated exactly by @TwinRect.
+ */
+template<class DataType = double>
+requires floating<DataType>
+class DistIndex {
+public:
+  using result_type = std::vector<std::pair<std::size_t, DataType> >;
+
+  /**
+   * @brief Build the index from a range of rectangles.
+   * @param rects the range of @Rect<DataType> objects.
+   * @param leaf_size the maximal number of rectangles in a leaf.
+   */
+  template<std::ranges::input_range Range>
+  requires std::same_as<std::ranges::range_value_t<Range>, Rect<DataType> >
+  explicit DistIndex(Range&& rects, std::size_t leaf_size = 16)
+      : rects_(std::ranges::begin(rects), std::ranges::end(rects)),
+        leaf_size_(std::max<std::size_t>(leaf_size, 1)) {
+    order_.resize(rects_.size());
+    std::iota(order_.begin(), order_.end(), 0);
+    if (!rects_.empty()) _build(0, rects_.size());
+    // Store the rectangles in the order of leaves.
+    std::vector<Rect<DataType> > sorted;
+    for (std::size_t i : order_) sorted.push_back(rects_[i]);
+    rects_ = std::move(sorted);
+  }
+
+  // The number of rectangles.
+  auto size() const { return rects_.size(); }
+
+  /**
+   * @brief Find the @k rectangles with the smallest expected distances to
+   *  @query.
+   * @return pairs of the indices (in the order of construction) and the
+   *  expected distances, in ascending order of the distances.
+   */
+  auto nearest(const Rect<DataType>& query, std::size_t k) const
+      -> result_type {
+    result_type result;
+    if (rects_.empty() || k == 0) return result;
+    const Summary q = _summary(query);
+
+    // The k smallest upper bounds and the k smallest exact values, each of
+    // distinct rectangles. Either k-th value bounds the k-th distance, so
+    // the threshold is the smaller one. The exact values are not fed into
+    // the upper bounds, where their rectangles are already counted.
+    std::priority_queue<DataType> bounds;
+    std::priority_queue<std::pair<DataType, std::size_t> > best;
+    auto threshold = [&] {
+      constexpr DataType inf = std::numeric_limits<DataType>::infinity();
+      return std::min(bounds.size() < k ? inf : bounds.top(),
+                      best.size() < k ? inf : best.top().first);
+    };
+    auto bound = [&](DataType value) {
+      if (bounds.size() < k) bounds.push(value);
+      else if (value < bounds.top()) bounds.pop(), bounds.push(value);
+    };
+
+    using entry_type = std::pair<DataType, std::size_t>;
+    std::priority_queue<entry_type, std::vector<entry_type>,
+                        std::greater<entry_type> > queue;
+    queue.emplace(_lower_bound(q, nodes_[0]), 0);
+    while (!queue.empty()) {
+      auto [ lb, index ] = queue.top();
+      queue.pop();
+      if (lb > threshold()) break;
+      const Node& node = nodes_[index];
+      if (node.left) {
+        for (std::size_t child : { node.left, node.right })
+          if (DataType clb = _lower_bound(q, nodes_[child]);
+              clb <= threshold())
+            queue.emplace(clb, child);
+        continue;
+      }
+      // Tighten the threshold by the upper bounds of the whole leaf before
+      // evaluating any of its rectangles.
+      for (std::size_t i = node.begin; i != node.end; ++i)
+        bound(_upper_bound(q, _summary(rects_[i])));
+      for (std::size_t i = node.begin; i != node.end; ++i) {
+        if (_lower_bound(q, _summary(rects_[i])) > threshold()) continue;
+        DataType value = expected_dist(query, rects_[i]);
+        best.emplace(value, order_[i]);
+        if (best.size() > k) best.pop();
+      }
+    }
+
+    for (; !best.empty(); best.pop())
+      result.emplace_back(best.top().second, best.top().first);
+    std::reverse(result.begin(), result.end());
+    return result;
+  }
+
+  /**
+   * @brief Answer a batch of queries in parallel.
+   */
+  auto nearest(std::span<const Rect<DataType> > queries, std::size_t k) const
+      -> std::vector<result_type> {
+    std::vector<result_type> result(queries.size());
+#pragma omp parallel for schedule(dynamic)
+    for (std::size_t i = 0; i < queries.size(); ++i)
+      result[i] = nearest(queries[i], k);
+    return result;
+  }
+
+private:
+  // The attributes of a rectangle for the bounds. The variance is the sum
+  // of the variances in both dimensions, i.e. (w^2 + h^2) / 12.
+  struct Summary {
+    DataType x1, x2, y1, y2, cx, cy, var;
+  };
+
+  struct Node {
+    std::size_t begin, end, left, right;
+    // The bounding boxes of rectangles and centers.
+    DataType x1, x2, y1, y2, cx1, cx2, cy1, cy2;
+  };
+
+  static auto _summary(const Rect<DataType>& rect) -> Summary {
+    auto [ w, h ] = rect.shape();
+    return { rect.x1(), rect.x2(), rect.y1(), rect.y2(),
+             rect.x1() + w / 2, rect.y1() + h / 2, (w * w + h * h) / 12 };
+  }
+
+  // The distance from a value to an interval.
+  static auto _gap(DataType x, DataType lo, DataType hi) {
+    return std::max({ lo - x, x - hi, DataType(0) });
+  }
+
+  static auto _lower_bound(const Summary& q, const Summary& r) -> DataType {
+    DataType cx = q.cx - r.cx, cy = q.cy - r.cy;
+    DataType dx = std::max({ r.x1 - q.x2, q.x1 - r.x2, DataType(0) });
+    DataType dy = std::max({ r.y1 - q.y2, q.y1 - r.y2, DataType(0) });
+    return std::sqrt(std::max(cx * cx + cy * cy, dx * dx + dy * dy));
+  }
+
+  static auto _lower_bound(const Summary& q, const Node& node) -> DataType {
+    DataType cx = _gap(q.cx, node.cx1, node.cx2);
+    DataType cy = _gap(q.cy, node.cy1, node.cy2);
+    DataType dx = std::max({ node.x1 - q.x2, q.x1 - node.x2, DataType(0) });
+    DataType dy = std::max({ node.y1 - q.y2, q.y1 - node.y2, DataType(0) });
+    return std::sqrt(std::max(cx * cx + cy * cy, dx * dx + dy * dy));
+  }
+
+  static auto _upper_bound(const Summary& q, const Summary& r) -> DataType {
+    DataType cx = q.cx - r.cx, cy = q.cy - r.cy;
+    DataType dx = std::max(r.x2 - q.x1, q.x2 - r.x1);
+    DataType dy = std::max(r.y2 - q.y1, q.y2 - r.y1);
+    return std::sqrt(std::min(cx * cx + cy * cy + q.var + r.var,
+                              dx * dx + dy * dy));
+  }
+
+  // Build the subtree of the rectangles order_[begin, end), and return the
+  // index of its root.
+  auto _build(std::size_t begin, std::size_t end) -> std::size_t {
+    const std::size_t index = nodes_.size();
+    const auto inf = std::numeric_limits<DataType>::infinity();
+    Node node { begin, end, 0, 0, inf, -inf, inf, -inf, inf, -inf, inf, -inf };
+    for (std::size_t k = begin; k != end; ++k) {
+      Summary r = _summary(rects_[order_[k]]);
+      node.x1 = std::min(node.x1, r.x1), node.x2 = std::max(node.x2, r.x2);
+      node.y1 = std::min(node.y1, r.y1), node.y2 = std::max(node.y2, r.y2);
+      node.cx1 = std::min(node.cx1, r.cx), node.cx2 = std::max(node.cx2, r.cx);
+      node.cy1 = std::min(node.cy1, r.cy), node.cy2 = std::max(node.cy2, r.cy);
+    }
+    nodes_.push_back(node);
+    if (end - begin <= leaf_size_) return index;
+
+    const bool axis = node.cy2 - node.cy1 > node.cx2 - node.cx1;
+    const std::size_t mid = begin + (end - begin) / 2;
+    std::nth_element(order_.begin() + begin, order_.begin() + mid,
+                     order_.begin() + end, [&](std::size_t i, std::size_t j) {
+                       const auto& a = rects_[i];
+                       const auto& b = rects_[j];
+                       return axis ? a.y1() + a.y2() < b.y1() + b.y2()
+                                   : a.x1() + a.x2() < b.x1() + b.x2();
+                     });
+    std::size_t left = _build(begin, mid);
+    std::size_t right = _build(mid, end);
+    nodes_[index].left = left, nodes_[index].right = right;
+    return index;
+  }
+
+  // Rectangles in the order of leaves, and their indices of construction.
+  std::vector<Rect<DataType> > rects_;
+  std::vector<std::size_t> order_;
+
+  // Nodes of the tree, where nodes_[0] is the root.
+  std::size_t leaf_size_;
+  std::vector<Node> nodes_;
+};
+
+} // namespace fiocca
+
+#endif // FIOCCA_EXPECTED_DIST_INDEX_HPP_
@@ -0,0 +1,512 @@
+#ifndef FIOCCA_EXPECTED_DIST_LOOKUP_HPP_
+#define FIOCCA_EXPECTED_DIST_LOOKUP_HPP_
+
+#include <span>
+#include <array>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include "rect.hpp"
+#include "expected_dist.hpp"
+#include "expected_dist_batch.hpp"
+#include "expected_dist_file.hpp"
+
+namespace fiocca {
+
+/**
+ * @brief The binary layout of lookup files, little-endian throughout. Each
+ *  file starts with a header of 32 bytes:
+ *      offset  0: char[8]  magic, "FIOCCALT",
+ *      offset  8: uint32   version, currently 2,
+ *      offset 12: uint32   coarse, the number of blocks per parameter,
+ *      offset 16: uint64   count, the number of stored values,
+ *      offset 24: float64  est_error, the estimated relative error.
+ *  It is followed by coarse^5 block records of 16 bytes, each the uint64
+ *  offset of the values of the block and five uint8 refinement levels
+ *  padded to 8 bytes, and then by the count values in float32. The values
+ *  of a block are stored cell by cell, each cell being its 32 corners with
+ *  the bit d of the corner index set on the upper side of the parameter d.
+ *  Version 1 stored the nodes of the lattices instead, and is rejected.
+ */
+struct LookupHeader {
+  static constexpr char magic_str[] = "FIOCCALT";
+  static constexpr std::uint32_t current_version = 2;
+
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t coarse;
+  std::uint64_t count;
+  double est_error;
+};
+static_assert(sizeof(LookupHeader) == 32);
+
+/**
+ * @brief An approximate expected distance by interpolation in a table
+ *  precomputed by @TwinRect. The expected distance scales linearly with
+ *  the geometry, and is invariant under swapping the rectangles, mirroring
+ *  and transposing. Hence the rectangles are first ordered such that the
+ *  width w1 of the first one is the largest side, and the shape depends on
+ *  five parameters in [0, 1],
+ *      h1 / w1, w2 / w1, h2 / w1, t(|cx|) and t(|cy|),
+ *  where (cx, cy) is the offset between the centers in units of w1, and
+ *  t(c) = c / (1 + c) compacts the offsets. The table stores the ratio of
+ *  the expected distance to the root mean square distance, which tends to
+ *  1 for far apart rectangles and whose relative error is the one of the
+ *  expected distance.
+ *
+ *  The parameter space is divided into coarse^5 blocks, and each block is
+ *  a regular lattice refined adaptively, dimension by dimension, until the
+ *  multilinear interpolation is within the tolerance. A query locates its
+ *  block and lattice cell in constant time, and interpolates the 32
+ *  corners of the cell, which are stored contiguously in two cache lines
+ *  instead of 32 scattered nodes. The nodes are thus repeated in up to 32
+ *  cells, e.g. 1.75M values for the 264k nodes of 3e-3 and 33M values for
+ *  the 2.5M nodes of 1e-3.
+ *
+ *  The errors are measured, after rounding the values to float, at the
+ *  midpoints of all edges, faces and cells of the lattices, where the
+ *  leading terms of the error of multilinear interpolation peak. The
+ *  higher order terms may still peak elsewhere, by about 5% more in dense
+ *  random samples, so the estimated error is the maximal measured one
+ *  times @safety_factor, and the blocks are refined until it is within the
+ *  tolerance. It is an estimate from samples, NOT a guaranteed bound:
+ *  errors between the samples are not bounded, and the blocks reaching
+ *  @max_level may exceed the tolerance. The table is hence meant for
+ *  approximate queries, e.g. ranking or coarse filtering, where a few
+ *  errors above the estimate are acceptable; expected_dist_adaptive()
+ *  guards the precision instead. The number of nodes grows about as
+ *  tolerance^(-5/2), e.g. 54k nodes for 1e-2 and 2.5M nodes for 1e-3.
+ */
+template<class DataType = double>
+requires floating<DataType>
+class DistLookup {
+public:
+  static constexpr std::size_t dims = 5;
+  static constexpr std::size_t corners = 1 << dims;
+
+  // The limit of the refinement levels, such that the (2^12 + 1)^5 nodes of
+  // the finest lattice are still representable in 64 bits, and so are its
+  // 2^60 cells.
+  static constexpr int level_limit = 12;
+
+  // The factor from the measured errors to the estimated one, which leaves
+  // a margin of about five times the excess seen in random samples.
+  static constexpr double safety_factor = 1.25;
+
+  /**
+   * @brief Build the table in parallel over blocks.
+   * @param tolerance the target of the relative error.
+   * @param coarse the number of blocks per parameter.
+   * @param max_level the maximal refinement level of each parameter in a
+   *  block, i.e. at most 2^max_level cells per parameter, clamped to
+   *  @level_limit.
+   */
+  explicit DistLookup(double tolerance = 1e-3, std::size_t coarse = 4,
+                      int max_level = 5)
+      : coarse_(std::max<std::size_t>(coarse, 1)) {
+    max_level = std::clamp(max_level, 0, level_limit);
+    const std::size_t nblocks = _pow(coarse_);
+    std::vector<std::vector<float>> nodes(nblocks);
+    std::vector<double> errors(nblocks);
+    blocks_.resize(nblocks);
+#pragma omp parallel for schedule(dynamic)
+    for (std::size_t b = 0; b < nblocks; ++b)
+      errors[b] = _refine(b, tolerance / safety_factor, max_level,
+                          blocks_[b], nodes[b]);
+    std::size_t count = 0;
+    for (const auto& block : blocks_) count += _cells(block).back() * corners;
+    values_.reserve(count);
+    for (std::size_t b = 0; b != nblocks; ++b) {
+      blocks_[b].offset = values_.size();
+      _store_cells(blocks_[b], nodes[b]);
+    }
+    est_error_ = safety_factor
+               * *std::max_element(errors.begin(), errors.end());
+  }
+
+  /**
+   * @brief Load a table from a lookup file, see @LookupHeader.
+   * @throw std::runtime_error if the file is malformed or cannot be read.
+   */
+  static auto load(const std::string& path) -> DistLookup {
+    detail::_check_endian();
+    std::ifstream file(path, std::ios::binary);
+    LookupHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+      throw std::runtime_error(path + " is too short for a lookup file.");
+    if (std::memcmp(header.magic, LookupHeader::magic_str, 8))
+      throw std::runtime_error(path + " is not a lookup file.");
+    if (header.version != LookupHeader::current_version)
+      throw std::runtime_error(path + " has an unsupported version.");
+    if (header.coarse == 0 || header.coarse > 64)
+      throw std::runtime_error(path + " has an invalid number of blocks.");
+
+    // Check the sizes against the file before allocating anything, and
+    // bound the count by division since a forged one may overflow.
+    file.seekg(0, std::ios::end);
+    const std::uint64_t size = file.tellg();
+    const std::uint64_t blocks_size = _pow(header.coarse) * sizeof(Block);
+    if (!file || size < sizeof(header) + blocks_size ||
+        header.count > (size - sizeof(header) - blocks_size) / sizeof(float))
+      throw std::runtime_error(path + " is truncated.");
+    file.seekg(sizeof(header));
+
+    DistLookup result(header);
+    file.read(reinterpret_cast<char*>(result.blocks_.data()),
+              result.blocks_.size() * sizeof(Block));
+    file.read(reinterpret_cast<char*>(result.values_.data()),
+              result.values_.size() * sizeof(float));
+    if (!file) throw std::runtime_error(path + " is truncated.");
+    // The levels are bounded first, so that the cells do not overflow, and
+    // the offset is compared without wrapping around.
+    for (const auto& block : result.blocks_)
+      if (std::ranges::any_of(block.levels,
+                              [](auto l) { return l > level_limit; }) ||
+          block.offset > header.count ||
+          _cells(block).back() > (header.count - block.offset) / corners)
+        throw std::runtime_error(path + " has an invalid block.");
+    return result;
+  }
+
+  /**
+   * @brief Save the table to a lookup file, see @LookupHeader.
+   * @throw std::runtime_error if the file cannot be written.
+   */
+  void save(const std::string& path) const {
+    detail::_check_endian();
+    LookupHeader header { { }, LookupHeader::current_version,
+                          static_cast<std::uint32_t>(coarse_),
+                          values_.size(), est_error_ };
+    std::memcpy(header.magic, LookupHeader::magic_str, 8);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(blocks_.data()),
+               blocks_.size() * sizeof(Block));
+    file.write(reinterpret_cast<const char*>(values_.data()),
+               values_.size() * sizeof(float));
+    if (!file) throw std::runtime_error("cannot write " + path);
+  }
+
+  // The estimated relative error, which is not a guaranteed bound, and
+  // the number of stored values, i.e. the corners of all cells.
+  auto est_error() const { return est_error_; }
+  auto size() const { return values_.size(); }
+
+  /**
+   * @brief Calculate the approximate expected distance between two
+   *  rectangles.
+   * @return the approximation, or NaN if a size or the offset between the
+   *  centers is not finite, which has no parameters in the table.
+   */
+  auto operator()(const Rect<DataType>& lhs,
+                  const Rect<DataType>& rhs) const -> DataType {
+    auto [ w1, h1 ] = lhs.shape();
+    auto [ w2, h2 ] = rhs.shape();
+    DataType cx = std::fabs(rhs.x1() + rhs.x2() - lhs.x1() - lhs.x2()) / 2;
+    DataType cy = std::fabs(rhs.y1() + rhs.y2() - lhs.y1() - lhs.y2()) / 2;
+    DataType rms = std::sqrt(cx * cx + cy * cy
+                             + (w1 * w1 + h1 * h1 + w2 * w2 + h2 * h2) / 12);
+    // Swap the rectangles and transpose, such that w1 is the largest.
+    // The swaps are selects, since random orders mispredict branches.
+    const bool swapped = std::max(w1, h1) < std::max(w2, h2);
+    _swap_if(swapped, w1, w2), _swap_if(swapped, h1, h2);
+    const bool transposed = w1 < h1;
+    _swap_if(transposed, w1, h1), _swap_if(transposed, w2, h2);
+    _swap_if(transposed, cx, cy);
+    // Non-finite parameters would index the table out of range.
+    if (!std::ranges::all_of(std::array { w1, h1, w2, h2, cx, cy },
+                             [](DataType x) { return std::isfinite(x); }))
+      return std::numeric_limits<DataType>::quiet_NaN();
+    // Both are points.
+    if (w1 == 0) return rms;
+    const std::array<DataType, dims> params = {
+      h1 / w1, w2 / w1, h2 / w1, cx / (w1 + cx), cy / (w1 + cy)
+    };
+    return rms * _interpolate(params);
+  }
+
+  /**
+   * @brief Calculate the approximate expected distances between pairs of
+   *  rectangles in parallel.
+   */
+  void operator()(const RectSpan<DataType>& lhs,
+                  const RectSpan<DataType>& rhs,
+                  std::span<DataType> result) const {
+#pragma omp parallel for
+    for (std::size_t i = 0; i < lhs.size(); ++i)
+      result[i] = (*this)(
+        Rect<DataType>(lhs.x1[i], lhs.x2[i], lhs.y1[i], lhs.y2[i]),
+        Rect<DataType>(rhs.x1[i], rhs.x2[i], rhs.y1[i], rhs.y2[i]));
+  }
+
+private:
+  // A block of the parameter space, whose lattice has 2^levels[d] cells
+  // along the parameter d, and whose cells start at offset.
+  struct Block {
+    std::uint64_t offset;
+    std::array<std::uint8_t, 8> levels;
+  };
+  static_assert(sizeof(Block) == 16);
+
+  using point_type = std::array<double, dims>;
+
+  // An empty table of the shape in @header.
+  explicit DistLookup(const LookupHeader& header)
+      : coarse_(header.coarse), blocks_(_pow(header.coarse)),
+        values_(header.count), est_error_(header.est_error) { }
+
+  // Swap @a and @b if @swap is true, without a branch.
+  static void _swap_if(bool swap, DataType& a, DataType& b) {
+    DataType lower = swap? b : a, upper = swap? a : b;
+    a = lower, b = upper;
+  }
+
+  static constexpr auto _pow(std::size_t n) {
+    return n * n * n * n * n;
+  }
+
+  using strides_type = std::array<std::size_t, dims + 1>;
+
+  // The strides of the lattice of a block, and its number of nodes.
+  static auto _lattice(const Block& block) {
+    strides_type strides;
+    strides[0] = 1;
+    for (std::size_t d = 0; d != dims; ++d)
+      strides[d + 1] = strides[d] * ((std::size_t(1) << block.levels[d]) + 1);
+    return strides;
+  }
+
+  // The strides of the cells of a block, and its number of cells.
+  static auto _cells(const Block& block) {
+    strides_type strides;
+    strides[0] = 1;
+    for (std::size_t d = 0; d != dims; ++d)
+      strides[d + 1] = strides[d] << block.levels[d];
+    return strides;
+  }
+
+  // The cell of the lattice of @block containing the local coordinates @x
+  // in [0, 1], and the coordinates of @x in the cell.
+  template<class T>
+  static auto _locate(const Block& block, const std::array<T, dims>& x)
+      -> std::pair<std::array<std::size_t, dims>, std::array<T, dims> > {
+    std::array<std::size_t, dims> index;
+    std::array<T, dims> frac;
+    for (std::size_t d = 0; d != dims; ++d) {
+      const std::size_t n = std::size_t(1) << block.levels[d];
+      T q = x[d] * T(n);
+      index[d] = std::min(static_cast<std::size_t>(q), n - 1);
+      frac[d] = q - T(index[d]);
+    }
+    return { index, frac };
+  }
+
+  // Append the nodes of @block to the table cell by cell, see @LookupHeader.
+  void _store_cells(const Block& block, const std::vector<float>& nodes) {
+    const auto strides = _lattice(block), cells = _cells(block);
+    std::array<std::size_t, corners> corner;
+    for (std::size_t c = 0; c != corners; ++c) {
+      corner[c] = 0;
+      for (std::size_t d = 0; d != dims; ++d)
+        if (c >> (dims - 1 - d) & 1) corner[c] += strides[d];
+    }
+    for (std::size_t k = 0; k != cells[dims]; ++k) {
+      std::size_t base = 0;
+      for (std::size_t d = 0; d != dims; ++d)
+        base += k / cells[d] % (cells[d + 1] / cells[d]) * strides[d];
+      for (std::size_t c = 0; c != corners; ++c)
+        values_.push_back(nodes[base + corner[c]]);
+    }
+  }
+
+  // The ratio of the expected distance to the root mean square distance
+  // at the parameters @p.
+  static auto _exact(const point_type& p) -> double {
+    if (p[3] >= 1 || p[4] >= 1) return 1;
+    double cx = p[3] / (1 - p[3]), cy = p[4] / (1 - p[4]);
+    Rect<double> lhs(-0.5, 0.5, -p[0] / 2, p[0] / 2);
+    Rect<double> rhs(cx - p[1] / 2, cx + p[1] / 2,
+                     cy - p[2] / 2, cy + p[2] / 2);
+    double rms = std::sqrt(cx * cx + cy * cy
+                           + (1 + p[0] * p[0] + p[1] * p[1] + p[2] * p[2])
+                           / 12);
+    return expected_dist(lhs, rhs) / rms;
+  }
+
+  // The multilinear interpolation of the nodes of the lattice of @block,
+  // with local coordinates @x in [0, 1] of the block.
+  template<class T>
+  static auto _multilinear(const Block& block, const float* nodes,
+                           const std::array<T, dims>& x) -> T {
+    auto strides = _lattice(block);
+    auto [ index, frac ] = _locate(block, x);
+    std::size_t base = 0;
+    for (std::size_t d = 0; d != dims; ++d) base += index[d] * strides[d];
+    return _lerp<dims>(nodes + base, strides, frac);
+  }
+
+  // Interpolate the corners of a cell along the first @D parameters, which
+  // unrolls into a tree of 2^D - 1 linear interpolations. The tree is the
+  // same for the nodes of a lattice and for the corners of a stored cell.
+  template<std::size_t D, class T>
+  static auto _lerp(const float* values, const strides_type& strides,
+                    const std::array<T, dims>& frac) -> T {
+    if constexpr (D == 0) return *values;
+    else {
+      T lower = _lerp<D - 1>(values, strides, frac);
+      T upper = _lerp<D - 1>(values + strides[D - 1], strides, frac);
+      return lower + (upper - lower) * frac[D - 1];
+    }
+  }
+
+  // Interpolate the stored corners of a cell, whose halves differ in the
+  // first parameter, then their halves in the second one, and so on. This
+  // is the same tree as _lerp(), evaluated level by level in simd lanes of
+  // float, whose rounding adds about 1e-7 to the relative error.
+  template<std::size_t D = 0, class T, class Values>
+  static auto _lerp_cell(const Values& values, const std::array<T, dims>& frac)
+      -> T {
+    constexpr std::size_t half = corners >> (D + 1);
+    std::array<T, half> v;
+    for (std::size_t c = 0; c != half; ++c)
+      v[c] = T(values[c]) + (T(values[c + half]) - T(values[c])) * frac[D];
+    if constexpr (D + 1 == dims) return v[0];
+    else return _lerp_cell<D + 1>(v, frac);
+  }
+
+  auto _interpolate(const std::array<DataType, dims>& params) const
+      -> DataType {
+    std::array<DataType, dims> local;
+    std::size_t index = 0;
+    for (std::size_t d = dims; d-- != 0; ) {
+      DataType q = params[d] * DataType(coarse_);
+      std::size_t i = std::min(static_cast<std::size_t>(q), coarse_ - 1);
+      local[d] = q - DataType(i), index = index * coarse_ + i;
+    }
+    // Locate the cell as _locate() does, and its offset in the same loop.
+    const Block& block = blocks_[index];
+    std::array<float, dims> frac;
+    std::size_t at = 0;
+    for (std::size_t d = 0, shift = 0; d != dims; shift += block.levels[d++]) {
+      const std::ptrdiff_t n = std::ptrdiff_t(1) << block.levels[d];
+      DataType q = local[d] * DataType(n);
+      std::ptrdiff_t i = std::min(static_cast<std::ptrdiff_t>(q), n - 1);
+      frac[d] = static_cast<float>(q - DataType(i));
+      at += std::size_t(i) << shift;
+    }
+    return _lerp_cell(values_.data() + block.offset + at * corners, frac);
+  }
+
+  // The parameters of the local coordinates @x in the block @b.
+  auto _point(std::size_t b, const point_type& x) const -> point_type {
+    point_type result;
+    for (std::size_t d = 0; d != dims; ++d, b /= coarse_)
+      result[d] = (double(b % coarse_) + x[d]) / double(coarse_);
+    return result;
+  }
+
+  // Tabulate the block @b at the levels of @block into @values.
+  void _tabulate(std::size_t b, const Block& block,
+                 std::vector<float>& values) const {
+    auto strides = _lattice(block);
+    values.resize(strides[dims]);
+    for (std::size_t k = 0; k != strides[dims]; ++k) {
+      point_type x;
+      for (std::size_t d = 0; d != dims; ++d)
+        x[d] = double(k / strides[d] % (strides[d + 1] / strides[d]))
+               / double(std::size_t(1) << block.levels[d]);
+      values[k] = static_cast<float>(_exact(_point(b, x)));
+    }
+  }
+
+  /**
+   * @brief The maximal relative error of the block @b over the points
+   *  x[d] = (i + shift[d]) / scale[d] for 0 <= i < counts[d].
+   */
+  auto _max_error(std::size_t b, const Block& block,
+                  const std::vector<float>& values,
+                  const std::array<std::size_t, dims>& counts,
+                  const point_type& shift, const point_type& scale) const {
+    std::size_t total = 1;
+    for (auto count : counts) total *= count;
+    double result = 0;
+    for (std::size_t k = 0; k != total; ++k) {
+      point_type x;
+      for (std::size_t d = 0, rest = k; d != dims; rest /= counts[d++])
+        x[d] = (double(rest % counts[d]) + shift[d]) / scale[d];
+      double exact = _exact(_point(b, x));
+      double approx = _multilinear(block, values.data(), x);
+      result = std::max(result, std::fabs(approx - exact) / exact);
+    }
+    return result;
+  }
+
+  /**
+   * @brief Refine the block @b until its errors are within @tolerance. The
+   *  errors at the midpoints of the lattice edges along each parameter
+   *  measure the interpolation in that parameter alone, and the cells are
+   *  doubled along the parameter of the largest one. The block is then
+   *  checked on the lattice of half the spacing, i.e. at the midpoints
+   *  of all edges, faces and cells, or of a quarter of the block for the
+   *  coarse parameters.
+   * @return the maximal measured error of the block.
+   */
+  auto _refine(std::size_t b, double tolerance, int max_level,
+               Block& block, std::vector<float>& values) const -> double {
+    block = { 0, { } };
+    for (;;) {
+      _tabulate(b, block, values);
+      std::array<std::size_t, dims> counts;
+      point_type shift, scale;
+      std::array<double, dims> errors;
+      for (std::size_t d = 0; d != dims; ++d) {
+        for (std::size_t e = 0; e != dims; ++e) {
+          const std::size_t n = std::size_t(1) << block.levels[e];
+          counts[e] = e == d? n : n + 1;
+          shift[e] = e == d? 0.5 : 0, scale[e] = double(n);
+        }
+        errors[d] = _max_error(b, block, values, counts, shift, scale);
+      }
+      std::size_t next = dims;
+      for (std::size_t d = 0; d != dims; ++d)
+        if (block.levels[d] < max_level &&
+            (next == dims || errors[d] > errors[next]))
+          next = d;
+      double error = *std::max_element(errors.begin(), errors.end());
+      if (error <= tolerance || next == dims) {
+        for (std::size_t d = 0; d != dims; ++d) {
+          const std::size_t n = std::max<std::size_t>(
+            std::size_t(2) << block.levels[d], 4);
+          counts[d] = n + 1, shift[d] = 0, scale[d] = double(n);
+        }
+        // The errors of the parameters may add up in the interior.
+        error = std::max(error, _max_error(b, block, values, counts,
+                                           shift, scale));
+        if (error <= tolerance || next == dims) return error;
+      }
+      ++block.levels[next];
+    }
+  }
+
+  // The number of blocks per parameter.
+  std::size_t coarse_;
+
+  // The blocks and their tabulated values.
+  std::vector<Block> blocks_;
+  std::vector<float> values_;
+
+  // The estimated relative error.
+  double est_error_;
+};
+
+} // namespace fiocca
+
+#endif // FIOCCA_EXPECTED_DIST_LOOKUP_HPP_
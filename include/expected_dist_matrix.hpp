@@ -0,0 +1,142 @@
+#ifndef FIOCCA_EXPECTED_DIST_MATRIX_HPP_
+#define FIOCCA_EXPECTED_DIST_MATRIX_HPP_
+
+#include <span>
+#include <vector>
+#include <ranges>
+#include "rect.hpp"
+#include "expected_dist_batch.hpp"
+
+namespace fiocca {
+
+/**
+ * @brief The all-pairs expected distance matrix of a set of rectangles.
+ *  Since the matrix is symmetric, only the upper triangle (including the
+ *  diagonal) is evaluated. The triangle is divided into square tiles so
+ *  that the coordinates and the output rows of a tile stay in cache, and
+ *  the tiles are evaluated in parallel. Inside a tile, each row is
+ *  evaluated by @TwinRectSimd with the columns packed into simd lanes.
+ *
+ *  The result can be written either to a dense row-major buffer of size
+ *  n * n, or to a packed buffer storing the upper triangle row by row,
+ *  of size n * (n + 1) / 2, see packed_index().
+ */
+template<class DataType = double>
+requires floating<DataType>
+class DistMatrix {
+public:
+  using twin_type = TwinRectSimd<DataType>;
+  using value_type = typename twin_type::value_type;
+
+  /**
+   * @brief Construct the engine from a range of rectangles. The
+   *  coordinates are copied into padded structure-of-arrays buffers.
+   * @param rects the range of @Rect<DataType> objects.
+   * @param tile the number of rows (and columns) of each tile.
+   */
+  template<std::ranges::input_range Range>
+  requires std::same_as<std::ranges::range_value_t<Range>, Rect<DataType> >
+  explicit DistMatrix(Range&& rects, std::size_t tile = 128)
+      : tile_(std::max(_round(tile), twin_type::size())) {
+    for (const auto& rect : rects) {
+      x1_.push_back(rect.x1()), x2_.push_back(rect.x2());
+      y1_.push_back(rect.y1()), y2_.push_back(rect.y2());
+    }
+    size_ = x1_.size();
+    // The padded lanes are filled with unit squares, whose results are
+    // evaluated but never written.
+    x1_.resize(_round(size_), 0), x2_.resize(_round(size_), 1);
+    y1_.resize(_round(size_), 0), y2_.resize(_round(size_), 1);
+  }
+
+  // The number of rectangles, i.e. the number of rows of the matrix.
+  auto size() const { return size_; }
+
+  // The size of the packed upper triangle.
+  static constexpr auto packed_size(std::size_t n) {
+    return n * (n + 1) / 2;
+  }
+
+  // The index of entry (i, j) in the packed upper triangle. The indices
+  // are swapped if i > j since the matrix is symmetric.
+  constexpr auto packed_index(std::size_t i, std::size_t j) const {
+    if (i > j) std::swap(i, j);
+    return i * size_ - i * (i - 1) / 2 + (j - i);
+  }
+
+  /**
+   * @brief Evaluate the full matrix into a dense row-major buffer. The
+   *  lower triangle is mirrored from the upper triangle.
+   * @param result the output buffer of size n * n.
+   */
+  void dense(std::span<DataType> result) const {
+    _evaluate([&](std::size_t i, std::size_t j, std::span<const DataType> row) {
+      std::ranges::copy(row, result.begin() + i * size_ + j);
+      for (std::size_t k = 0; k != row.size(); ++k)
+        result[(j + k) * size_ + i] = row[k];
+    });
+  }
+
+  /**
+   * @brief Evaluate the upper triangle into a packed buffer.
+   * @param result the output buffer of size packed_size(n).
+   */
+  void packed(std::span<DataType> result) const {
+    _evaluate([&](std::size_t i, std::size_t j, std::span<const DataType> row) {
+      std::ranges::copy(row, result.begin() + packed_index(i, j));
+    });
+  }
+
+private:
+  // Round up to a multiple of the simd width.
+  static constexpr auto _round(std::size_t n) {
+    constexpr std::size_t width = twin_type::size();
+    return (n + width - 1) / width * width;
+  }
+
+  // Evaluate all tiles in the upper triangle. The callback @write receives
+  // the segment of row i starting at column j, where i <= j.
+  template<class Writer>
+  void _evaluate(Writer&& write) const {
+    constexpr std::size_t width = twin_type::size();
+    constexpr auto aligned = simd::stdx::element_aligned;
+    const std::size_t ntiles = (size_ + tile_ - 1) / tile_;
+    std::vector<std::pair<std::size_t, std::size_t> > tiles;
+    for (std::size_t ti = 0; ti != ntiles; ++ti)
+      for (std::size_t tj = ti; tj != ntiles; ++tj)
+        tiles.emplace_back(ti * tile_, tj * tile_);
+
+#pragma omp parallel for schedule(dynamic)
+    for (std::size_t t = 0; t < tiles.size(); ++t) {
+      auto [ row0, col0 ] = tiles[t];
+      const std::size_t row1 = std::min(row0 + tile_, size_);
+      const std::size_t col1 = std::min(col0 + tile_, size_);
+      std::vector<DataType> buffer(tile_);
+      for (std::size_t i = row0; i != row1; ++i) {
+        // Columns before the diagonal are skipped, aligned to the width.
+        const std::size_t first = std::max(col0, i);
+        const std::size_t begin = first - (first - col0) % width;
+        const value_type ax1(x1_[i]), ax2(x2_[i]), ay1(y1_[i]), ay2(y2_[i]);
+        for (std::size_t j = begin; j < col1; j += width) {
+          twin_type twin_rect(
+            ax1, ax2, ay1, ay2,
+            value_type(&x1_[j], aligned), value_type(&x2_[j], aligned),
+            value_type(&y1_[j], aligned), value_type(&y2_[j], aligned));
+          twin_rect.dist().copy_to(&buffer[j - col0], aligned);
+        }
+        write(i, first, std::span<const DataType>(
+          &buffer[first - col0], col1 - first));
+      }
+    }
+  }
+
+  // The number of rectangles and the size of tiles.
+  std::size_t size_, tile_;
+
+  // Padded coordinates of all rectangles.
+  std::vector<DataType> x1_, x2_, y1_, y2_;
+};
+
+} // namespace fiocca
+
+#endif // FIOCCA_EXPECTED_DIST_MATRIX_HPP_
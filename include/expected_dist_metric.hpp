@@ -0,0 +1,273 @@
+#ifndef FIOCCA_EXPECTED_DIST_METRIC_HPP_
+#define FIOCCA_EXPECTED_DIST_METRIC_HPP_
+
+#include <span>
+#include <array>
+#include <utility>
+#include <algorithm>
+#include "rect.hpp"
+#include "simd.hpp"
+#include "expected_dist.hpp"
+#include "expected_dist_batch.hpp"
+
+namespace fiocca {
+
+namespace detail {
+
+/**
+ * @brief The expected absolute difference E|v - u|, where u and v are
+ *  uniformly distributed on [a1, a2] and [b1, b2] respectively. Let
+ *  s = v - u, and swap the intervals so that E[s] >= 0. Then
+ *  |s| = s + 2 (-s)_+, where the second term only involves the overlap of
+ *  the intervals:
+ *      E[(u - v)_+] = [(a2 - b1)_+^3 - (a2 - b2)_+^3 - (a1 - b1)_+^3
+ *                      + (a1 - b2)_+^3] / (6 w1 w2),
+ *  which lowers the order in a degenerated interval. Disjoint intervals
+ *  take the difference of the midpoints exactly, without cancellation.
+ */
+template<class DataType>
+requires floating<DataType>
+constexpr auto _expected_abs(DataType a1, DataType a2,
+                             DataType b1, DataType b2) -> DataType {
+  DataType mean = (b1 + b2 - a1 - a2) / 2;
+  if (mean < 0) std::swap(a1, b1), std::swap(a2, b2), mean = -mean;
+  DataType w1 = a2 - a1, w2 = b2 - b1;
+  auto ramp = [](DataType x) { return std::max<DataType>(x, 0); };
+  DataType p = ramp(a2 - b1), q = ramp(a2 - b2);
+  DataType r = ramp(a1 - b1), s = ramp(a1 - b2);
+  DataType tail = p;
+  if (w1 && w2)
+    tail = (p * p * p - q * q * q - r * r * r + s * s * s) / (6 * w1 * w2);
+  else if (w2) tail = (p * p - q * q) / (2 * w2);
+  else if (w1) tail = (p * p - r * r) / (2 * w1);
+  return mean + 2 * tail;
+}
+
+// Data-parallel counterpart of _expected_abs(), where the intervals may be
+// unordered as in @RectSpan.
+template<class Simd>
+requires simd::vectorized<Simd>
+auto _expected_abs(const Simd& u1, const Simd& u2,
+                   const Simd& v1, const Simd& v2) -> Simd {
+  Simd a1 = simd::stdx::min(u1, u2), a2 = simd::stdx::max(u1, u2);
+  Simd b1 = simd::stdx::min(v1, v2), b2 = simd::stdx::max(v1, v2);
+  Simd mean = (b1 + b2 - a1 - a2) / 2;
+  auto swap = mean < 0;
+  Simd t1 = a1, t2 = a2;
+  where(swap, a1) = b1, where(swap, a2) = b2;
+  where(swap, b1) = t1, where(swap, b2) = t2;
+  Simd w1 = a2 - a1, w2 = b2 - b1;
+  auto ramp = [](const Simd& x) { return simd::stdx::max(x, Simd(0)); };
+  Simd p = ramp(a2 - b1), q = ramp(a2 - b2);
+  Simd r = ramp(a1 - b1), s = ramp(a1 - b2);
+  // The numerators and denominators of the cases are selected before a
+  // single division.
+  Simd num = p, den = 1;
+  auto both = w1 != 0 && w2 != 0;
+  where(both, num) = p * p * p - q * q * q - r * r * r + s * s * s;
+  where(both, den) = 6 * w1 * w2;
+  where(w1 == 0 && w2 != 0, num) = p * p - q * q;
+  where(w1 == 0 && w2 != 0, den) = 2 * w2;
+  where(w1 != 0 && w2 == 0, num) = p * p - r * r;
+  where(w1 != 0 && w2 == 0, den) = 2 * w1;
+  return simd::stdx::abs(mean) + 2 * num / den;
+}
+
+/**
+ * @brief The distribution of |v - u|, where u and v are uniformly
+ *  distributed on [a1, a2] and [b1, b2] respectively. The density of v - u
+ *  is a trapezoid with breakpoints @coord, the same as TwinRect::coord0,
+ *  so the distribution function of |v - u| is a piecewise quadratic with
+ *  breakpoints 0 and |coord[k]|.
+ */
+template<class DataType>
+requires floating<DataType>
+class AbsDiff {
+public:
+  constexpr AbsDiff(DataType a1, DataType a2, DataType b1, DataType b2) {
+    lo_ = std::min(a2 - a1, b2 - b1), hi_ = std::max(a2 - a1, b2 - b1);
+    coord = { b1 - a2, b1 - a2 + lo_, b2 - a1 - lo_, b2 - a1 };
+  }
+
+  // The distribution function P(|v - u| <= t) for t >= 0.
+  constexpr auto cdf(DataType t) const { return _cdf(t) - _cdf(-t); }
+
+  // Breakpoints of the trapezoid density.
+  std::array<DataType, 4> coord;
+
+private:
+  // The distribution function of v - u, where the ramps are evaluated from
+  // the nearest end point to avoid cancellation.
+  constexpr auto _cdf(DataType t) const -> DataType {
+    if (t <= coord[0]) return 0;
+    if (t >= coord[3]) return 1;
+    if (t < coord[1])
+      return (t - coord[0]) * (t - coord[0]) / (2 * lo_ * hi_);
+    if (t > coord[2])
+      return 1 - (coord[3] - t) * (coord[3] - t) / (2 * lo_ * hi_);
+    return (lo_ / 2 + (t - coord[1])) / hi_;
+  }
+
+  // The smaller and the larger lengths of the intervals.
+  DataType lo_, hi_;
+};
+
+} // namespace detail
+
+/**
+ * @brief The metric policies of expected distances, chosen at compile time
+ *  by the last argument of expected_dist(). Each policy provides the kernel
+ *  of a pair of rectangles and the batched kernel of @RectSpan.
+ *  - Euclidean: the L2 distance, forwarded to @TwinRect and @TwinRectSimd
+ *    without any overhead.
+ *  - Manhattan: the L1 distance, i.e. the sum of the expected absolute
+ *    differences in both dimensions, see detail::_expected_abs().
+ *  - Chebyshev: the L-infinity distance, see Chebyshev::dist().
+ */
+struct Euclidean {
+  template<class DataType>
+  static constexpr auto dist(const Rect<DataType>& lhs,
+                             const Rect<DataType>& rhs) {
+    return expected_dist(lhs, rhs);
+  }
+
+  template<class DataType>
+  static void dist(const RectSpan<DataType>& lhs,
+                   const RectSpan<DataType>& rhs,
+                   std::span<DataType> result) {
+    expected_dist(lhs, rhs, result);
+  }
+};
+
+struct Manhattan {
+  template<class DataType>
+  static constexpr auto dist(const Rect<DataType>& lhs,
+                             const Rect<DataType>& rhs) {
+    return detail::_expected_abs(lhs.x1(), lhs.x2(), rhs.x1(), rhs.x2())
+         + detail::_expected_abs(lhs.y1(), lhs.y2(), rhs.y1(), rhs.y2());
+  }
+
+  // The pairs are packed into simd lanes, since the kernel only consists of
+  // a few arithmetic operations.
+  template<class DataType>
+  static void dist(const RectSpan<DataType>& lhs,
+                   const RectSpan<DataType>& rhs,
+                   std::span<DataType> result) {
+    using value_type = simd::native_t<DataType>;
+    constexpr std::size_t width = value_type::size();
+    constexpr auto aligned = simd::stdx::element_aligned;
+    const std::size_t size = lhs.size();
+    const std::size_t body = size - size % width;
+    auto kernel = [&](auto&& load) {
+      return detail::_expected_abs(load(lhs.x1), load(lhs.x2),
+                                   load(rhs.x1), load(rhs.x2))
+           + detail::_expected_abs(load(lhs.y1), load(lhs.y2),
+                                   load(rhs.y1), load(rhs.y2));
+    };
+#pragma omp parallel for
+    for (std::size_t i = 0; i < body; i += width)
+      kernel([&](std::span<const DataType> coords) {
+        return value_type(&coords[i], aligned);
+      }).copy_to(&result[i], aligned);
+    if (body == size) return;
+    value_type dist = kernel([&](std::span<const DataType> coords) {
+      return value_type([&](auto lane) {
+        return body + lane < size ? coords[body + lane] : 0;
+      });
+    });
+    for (std::size_t lane = 0; body + lane < size; ++lane)
+      result[body + lane] = dist[lane];
+  }
+};
+
+struct Chebyshev {
+  /**
+   * @brief The expected L-infinity distance. Let p and q be the absolute
+   *  differences in the two dimensions, which are independent. Then
+   *      E max(p, q) = \int_0^\infty (1 - P(p <= t) P(q <= t)) dt,
+   *  where the integrand is a polynomial of degree at most four between
+   *  the merged breakpoints of the two distributions, see detail::AbsDiff.
+   *  The three-point Gauss-Legendre rule is exact on each piece.
+   */
+  template<class DataType>
+  static constexpr auto dist(const Rect<DataType>& lhs,
+                             const Rect<DataType>& rhs) -> DataType {
+    detail::AbsDiff<DataType> p(lhs.x1(), lhs.x2(), rhs.x1(), rhs.x2());
+    detail::AbsDiff<DataType> q(lhs.y1(), lhs.y2(), rhs.y1(), rhs.y2());
+    std::array<DataType, 9> points { };
+    for (std::size_t k = 0; k != 4; ++k) {
+      points[k + 1] = math::fabs(p.coord[k]);
+      points[k + 5] = math::fabs(q.coord[k]);
+    }
+    std::ranges::sort(points);
+
+    // Nodes and weights of the Gauss-Legendre rule on [-1, 1].
+    constexpr DataType node = 0.774596669241483377035853079956479922L;
+    constexpr DataType weights[] = { DataType(5) / 9, DataType(8) / 9 };
+    auto integrand = [&](DataType t) { return 1 - p.cdf(t) * q.cdf(t); };
+    DataType result = 0;
+    for (std::size_t k = 0; k != 8; ++k) {
+      DataType half = (points[k + 1] - points[k]) / 2;
+      if (!half) continue;
+      DataType mid = points[k] + half;
+      result += half * (weights[0] * (integrand(mid - half * node)
+                                    + integrand(mid + half * node))
+                      + weights[1] * integrand(mid));
+    }
+    return result;
+  }
+
+  // The pairs are evaluated in parallel by the scalar kernel, since the
+  // breakpoints are sorted differently in each pair.
+  template<class DataType>
+  static void dist(const RectSpan<DataType>& lhs,
+                   const RectSpan<DataType>& rhs,
+                   std::span<DataType> result) {
+#pragma omp parallel for
+    for (std::size_t i = 0; i < lhs.size(); ++i)
+      result[i] = dist(Rect<DataType>(lhs.x1[i], lhs.x2[i],
+                                      lhs.y1[i], lhs.y2[i]),
+                       Rect<DataType>(rhs.x1[i], rhs.x2[i],
+                                      rhs.y1[i], rhs.y2[i]));
+  }
+};
+
+/**
+ * @brief Define the concept of metric policies, i.e. @Euclidean,
+ *  @Manhattan, @Chebyshev or user-defined policies with the same kernels.
+ */
+template<class Metric, class DataType>
+concept dist_metric = requires(const Rect<DataType>& rect,
+                               const RectSpan<DataType>& rects,
+                               std::span<DataType> result) {
+  { Metric::dist(rect, rect) } -> std::convertible_to<DataType>;
+  Metric::dist(rects, rects, result);
+};
+
+/**
+ * @brief Calculate the expected distance between two rectangles in the
+ *  metric chosen at compile time, e.g. expected_dist(lhs, rhs, Manhattan()).
+ */
+template<class DataType, class Metric>
+requires floating<DataType> && dist_metric<Metric, DataType>
+constexpr auto expected_dist(const Rect<DataType>& lhs,
+                             const Rect<DataType>& rhs, Metric) {
+  return Metric::dist(lhs, rhs);
+}
+
+/**
+ * @brief Calculate the expected distances between pairs of rectangles
+ *  stored as structure-of-arrays in the metric chosen at compile time.
+ *  Refer to the Euclidean version for the parameters.
+ */
+template<class DataType, class Metric>
+requires floating<DataType> && dist_metric<Metric, DataType>
+void expected_dist(const RectSpan<DataType>& lhs,
+                   const RectSpan<DataType>& rhs,
+                   std::span<DataType> result, Metric) {
+  Metric::dist(lhs, rhs, result);
+}
+
+} // namespace fiocca
+
+#endif // FIOCCA_EXPECTED_DIST_METRIC_HPP_
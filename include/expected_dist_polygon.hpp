@@ -0,0 +1,100 @@
+#ifndef FIOCCA_EXPECTED_DIST_POLYGON_HPP_
+#define FIOCCA_EXPECTED_DIST_POLYGON_HPP_
+
+#include <span>
+#include <vector>
+#include <stdexcept>
+#include "polygon.hpp"
+#include "expected_dist.hpp"
+#include "expected_dist_batch.hpp"
+
+namespace fiocca {
+
+/**
+ * @brief Calculate the expected distances between pairs of rectilinear
+ *  polygons, i.e. @result[i] is the expected distance between @lhs[i] and
+ *  @rhs[i]. Since a point uniformly selected from a polygon falls into each
+ *  rectangle of the partition with the probability proportional to its
+ *  area, the expected distance is the area weighted average over all pairs
+ *  of rectangles. The pairs of rectangles of all polygon pairs are gathered
+ *  and evaluated in one batch.
+ *
+ *  The average is undefined for polygons of zero area. A polygon of a
+ *  single rectangle, e.g. constructed from a line segment or a point, is
+ *  evaluated by the closed form of the rectangle instead, which covers
+ *  these degenerate cases. Other polygons of zero area, e.g. of degenerate
+ *  vertices without any rectangle, are rejected.
+ * @param lhs the lefthand side polygons.
+ * @param rhs the righthand side polygons, of the same size as @lhs.
+ * @param result the output buffer, of the same size as @lhs.
+ * @throw std::invalid_argument if a polygon of several or no rectangles has
+ *  zero area.
+ */
+template<class DataType>
+requires floating<DataType>
+void expected_dist(std::span<const RectilinearPolygon<DataType> > lhs,
+                   std::span<const RectilinearPolygon<DataType> > rhs,
+                   std::span<DataType> result) {
+  // The probability of a rectangle in its polygon, which is one for the
+  // polygons of a single rectangle even if it is degenerate.
+  auto probability = [](const RectilinearPolygon<DataType>& polygon,
+                        const Rect<DataType>& rect) -> DataType {
+    return polygon.rects().size() == 1? 1 : rect.area() / polygon.area();
+  };
+  std::size_t npairs = 0;
+  for (std::size_t i = 0; i != lhs.size(); ++i) {
+    for (const auto* polygon : { &lhs[i], &rhs[i] })
+      if (polygon->rects().size() != 1 && !(polygon->area() > 0))
+        throw std::invalid_argument("the polygon has zero area.");
+    npairs += lhs[i].rects().size() * rhs[i].rects().size();
+  }
+
+  // Coordinates of the pairs of rectangles in the structure-of-arrays form.
+  std::vector<DataType> buffer(npairs * 9);
+  auto column = [&](std::size_t k) {
+    return std::span<DataType>(buffer).subspan(k * npairs, npairs);
+  };
+  auto weights = column(8);
+  for (std::size_t i = 0, k = 0; i != lhs.size(); ++i) {
+    for (const auto& a : lhs[i].rects())
+      for (const auto& b : rhs[i].rects()) {
+        column(0)[k] = a.x1(), column(1)[k] = a.x2();
+        column(2)[k] = a.y1(), column(3)[k] = a.y2();
+        column(4)[k] = b.x1(), column(5)[k] = b.x2();
+        column(6)[k] = b.y1(), column(7)[k] = b.y2();
+        weights[k++] = probability(lhs[i], a) * probability(rhs[i], b);
+      }
+  }
+  std::vector<DataType> dist(npairs);
+  expected_dist(
+    RectSpan<DataType> { column(0), column(1), column(2), column(3) },
+    RectSpan<DataType> { column(4), column(5), column(6), column(7) },
+    std::span<DataType>(dist));
+
+  for (std::size_t i = 0, k = 0; i != lhs.size(); ++i) {
+    const std::size_t n = lhs[i].rects().size() * rhs[i].rects().size();
+    result[i] = 0;
+    for (std::size_t end = k + n; k != end; ++k)
+      result[i] += weights[k] * dist[k];
+  }
+}
+
+/**
+ * @brief Calculate the expected distance between two rectilinear polygons.
+ *  Refer to the batched version for details.
+ */
+template<class DataType>
+requires floating<DataType>
+auto expected_dist(const RectilinearPolygon<DataType>& lhs,
+                   const RectilinearPolygon<DataType>& rhs) -> DataType {
+  if (lhs.rects().size() == 1 && rhs.rects().size() == 1)
+    return expected_dist(lhs.rects().front(), rhs.rects().front());
+  DataType result;
+  expected_dist(std::span(&lhs, 1), std::span(&rhs, 1),
+                std::span(&result, 1));
+  return result;
+}
+
+} // namespace fiocca
+
+#endif // FIOCCA_EXPECTED_DIST_POLYGON_HPP_
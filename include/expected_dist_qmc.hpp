@@ -0,0 +1,496 @@
+#ifndef FIOCCA_EXPECTED_DIST_QMC_HPP_
+#define FIOCCA_EXPECTED_DIST_QMC_HPP_
+
+#include <span>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include <utility>
+#include <concepts>
+#include <algorithm>
+#include <type_traits>
+#include "simd.hpp"
+#include "rect.hpp"
+
+namespace fiocca {
+
+namespace qmc {
+
+namespace detail {
+
+// The splitmix64 generator, used to derive the seeds of streams.
+constexpr auto _mix(std::uint64_t x) -> std::uint64_t {
+  x += 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+// The primitive polynomial x ^ degree + ... + 1 of a Sobol dimension, whose
+// inner coefficients are the bits of @coeffs, and the initial direction
+// numbers @m (Joe and Kuo, new-joe-kuo-6.21201).
+struct SobolPoly {
+  unsigned degree, coeffs;
+  std::array<std::uint32_t, 6> m;
+};
+
+inline constexpr SobolPoly _sobol_polys[] = {
+  { 1, 0, { 1 } },                  { 2, 1, { 1, 3 } },
+  { 3, 1, { 1, 3, 1 } },            { 3, 2, { 1, 1, 1 } },
+  { 4, 1, { 1, 1, 3, 3 } },         { 4, 4, { 1, 3, 5, 13 } },
+  { 5, 2, { 1, 1, 5, 5, 17 } },     { 5, 4, { 1, 1, 5, 5, 5 } },
+  { 5, 7, { 1, 1, 7, 11, 19 } },    { 5, 11, { 1, 1, 5, 1, 1 } },
+  { 5, 13, { 1, 1, 1, 3, 11 } },    { 5, 14, { 1, 3, 5, 5, 31 } },
+  { 6, 1, { 1, 3, 3, 9, 7, 49 } },  { 6, 13, { 1, 1, 1, 15, 21, 21 } },
+  { 6, 16, { 1, 3, 1, 13, 27, 49 } }
+};
+
+// The direction numbers of all dimensions. The first dimension is the van
+// der Corput sequence.
+constexpr auto _sobol_directions() {
+  constexpr std::size_t dims = std::size(_sobol_polys) + 1;
+  std::array<std::array<std::uint32_t, 32>, dims> result { };
+  for (unsigned k = 0; k != 32; ++k) result[0][k] = 1u << (31 - k);
+  for (std::size_t j = 1; j != dims; ++j) {
+    const auto& [ s, a, m ] = _sobol_polys[j - 1];
+    auto& v = result[j];
+    for (unsigned k = 0; k != 32; ++k) {
+      if (k < s) { v[k] = m[k] << (31 - k); continue; }
+      v[k] = v[k - s] ^ (v[k - s] >> s);
+      for (unsigned l = 1; l != s; ++l)
+        if ((a >> (s - 1 - l)) & 1) v[k] ^= v[k - l];
+    }
+  }
+  return result;
+}
+
+inline constexpr auto sobol_directions = _sobol_directions();
+
+} // namespace detail
+
+/**
+ * @brief The Sobol sequence in up to 16 dimensions, randomized by the
+ *  linear matrix scrambling and a digital shift (Matousek). Each digit of
+ *  a coordinate is flipped by a random combination of the more significant
+ *  digits, and then by a random shift. The scrambled points are uniformly
+ *  distributed and keep the net properties of the sequence. Sequences of
+ *  different seeds are independent randomizations.
+ *
+ *  Since the scrambling is linear, it is folded into the direction numbers.
+ *  The points are enumerated in the Gray code order (Antonov and Saleev),
+ *  so that consecutive points only differ by one direction number. The
+ *  order only permutes the aligned blocks of 2 ^ m points.
+ */
+template<class DataType = double>
+requires floating<DataType>
+class Sobol {
+public:
+  using value_type = simd::native_t<DataType>;
+  using index_type = simd::stdx::rebind_simd_t<std::uint32_t, value_type>;
+  static constexpr std::size_t max_dim = detail::sobol_directions.size();
+
+  explicit Sobol(std::uint64_t seed = 0) {
+    std::uint64_t state = seed;
+    for (std::size_t j = 0; j != max_dim; ++j) {
+      // The k-th row of the random lower triangular matrix, applied to the
+      // k-th most significant digit.
+      std::array<std::uint32_t, 32> rows { };
+      for (unsigned k = 1; k != 32; ++k)
+        rows[k] = static_cast<std::uint32_t>(
+          (state = detail::_mix(state)) >> 32) & (~0u << (32 - k));
+      for (unsigned k = 0; k != 32; ++k) {
+        std::uint32_t v = detail::sobol_directions[j][k];
+        directions_[j][k] = 0;
+        for (unsigned l = 0; l != 32; ++l) {
+          std::uint32_t bit = (v >> (31 - l)) ^ std::popcount(rows[l] & v);
+          directions_[j][k] |= (bit & 1) << (31 - l);
+        }
+      }
+      shifts_[j] = static_cast<std::uint32_t>(state = detail::_mix(state));
+    }
+  }
+
+  // The @dim-th coordinate of the @index-th point.
+  auto at(std::uint32_t index, std::size_t dim) const -> DataType {
+    return _to_unit(_point(index ^ (index >> 1), dim));
+  }
+
+  /**
+   * @brief Generate the @dim-th coordinates of the points in [first, first
+   *  + size() * out.size()), where the size of @out is a power of two and
+   *  @first is a multiple of it. The lanes take consecutive ranges of
+   *  points.
+   */
+  void generate(std::uint32_t first, std::size_t dim,
+                std::span<value_type> out) const {
+    const std::uint32_t n = static_cast<std::uint32_t>(out.size());
+    index_type bits([&](auto lane) {
+      std::uint32_t index = first + static_cast<std::uint32_t>(lane) * n;
+      return _point(index ^ (index >> 1), dim);
+    });
+    // The trailing zeros of the steps are the same in all lanes since the
+    // ranges are aligned to n.
+    out[0] = _to_unit(bits);
+    for (std::uint32_t i = 1; i != n; ++i) {
+      bits ^= directions_[dim][std::countr_zero(i)];
+      out[i] = _to_unit(bits);
+    }
+  }
+
+private:
+  // Only the leading bits representable by @DataType are kept, so that the
+  // coordinates are never rounded up to 1.
+  static constexpr int shift =
+    std::max(0, 32 - std::numeric_limits<DataType>::digits);
+  static constexpr DataType scale = 0x1p-32 * (1u << shift);
+
+  auto _point(std::uint32_t index, std::size_t dim) const -> std::uint32_t {
+    std::uint32_t bits = shifts_[dim];
+    // The index is shifted down by one bit at a time, so that no shift
+    // reaches the width of 32 bits for indices from 2^31.
+    for (unsigned k = 0; index; ++k, index >>= 1)
+      if (index & 1) bits ^= directions_[dim][k];
+    return bits;
+  }
+
+  static auto _to_unit(std::uint32_t bits) -> DataType {
+    return (bits >> shift) * scale;
+  }
+  static auto _to_unit(const index_type& bits) -> value_type {
+    return simd::stdx::static_simd_cast<value_type>(bits >> shift) * scale;
+  }
+
+  // Scrambled direction numbers and digital shifts of all dimensions.
+  std::array<std::array<std::uint32_t, 32>, max_dim> directions_;
+  std::array<std::uint32_t, max_dim> shifts_;
+};
+
+/**
+ * @brief The Halton sequence in up to 16 dimensions, randomized by random
+ *  digit permutations. The k-th digit of the radical inverse in the j-th
+ *  dimension is permuted by its own random permutation, for all digits up
+ *  to the precision of @DataType (including the leading zeros of the
+ *  index), hence each point is uniformly distributed. Sequences of
+ *  different seeds are independent randomizations.
+ */
+template<class DataType = double>
+requires floating<DataType>
+class Halton {
+public:
+  using value_type = simd::native_t<DataType>;
+  static constexpr std::size_t max_dim = 16;
+
+  explicit Halton(std::uint64_t seed = 0) {
+    std::uint64_t state = seed;
+    for (std::size_t j = 0; j != max_dim; ++j) {
+      const unsigned base = primes[j];
+      offsets_[j] = perms_.size();
+      // The number of digits such that base ^ digits >= 2 ^ precision.
+      digits_[j] = static_cast<unsigned>(std::ceil(
+        std::numeric_limits<DataType>::digits / std::log2(base)));
+      for (unsigned k = 0; k != digits_[j]; ++k) {
+        // Fisher-Yates shuffle of the digits.
+        std::size_t begin = perms_.size();
+        for (unsigned d = 0; d != base; ++d) perms_.push_back(d);
+        for (unsigned d = base - 1; d; --d)
+          std::swap(perms_[begin + d],
+                    perms_[begin + (state = detail::_mix(state)) % (d + 1)]);
+      }
+      // The contributions of the permuted zeros from each digit on.
+      const unsigned char* perm = &perms_[offsets_[j]];
+      tails_[j][digits_[j]] = 0;
+      for (unsigned k = digits_[j]; k--; )
+        tails_[j][k] = (perm[k * base] + tails_[j][k + 1]) / base;
+      // The contributions of the lower digits, tabulated for all indices in
+      // a period of base ^ low_digits.
+      low_digits_[j] = 0, periods_[j] = 1, scales_[j] = 1;
+      for (; periods_[j] * base <= max_period && low_digits_[j] != digits_[j];
+             periods_[j] *= base)
+        ++low_digits_[j], scales_[j] /= base;
+      lows_[j].resize(periods_[j]);
+      for (std::uint32_t index = 0; index != periods_[j]; ++index) {
+        DataType low = 0;
+        std::uint32_t rest = index;
+        for (unsigned k = 0; k != low_digits_[j]; ++k, rest /= base)
+          low += perm[k * base + rest % base] * _power(base, k + 1);
+        lows_[j][index] = low;
+      }
+    }
+  }
+
+  // The @dim-th coordinate of the @index-th point.
+  auto at(std::uint32_t index, std::size_t dim) const -> DataType {
+    const std::uint32_t period = periods_[dim];
+    DataType result = lows_[dim][index % period] + _high(index / period, dim);
+    return std::min(result, one_minus);
+  }
+
+  /**
+   * @brief Generate the @dim-th coordinates of the points in [first, first
+   *  + size() * out.size()). The lanes take consecutive ranges of points.
+   */
+  void generate(std::uint32_t first, std::size_t dim,
+                std::span<value_type> out) const {
+    const std::uint32_t n = static_cast<std::uint32_t>(out.size());
+    const std::uint32_t period = periods_[dim];
+    for (std::size_t lane = 0; lane != value_type::size(); ++lane) {
+      std::uint32_t index = first + static_cast<std::uint32_t>(lane) * n;
+      std::uint32_t low = index % period, high = index / period;
+      DataType offset = _high(high, dim);
+      for (std::uint32_t i = 0; i != n; ++i) {
+        out[i][lane] = std::min(lows_[dim][low] + offset, one_minus);
+        if (++low == period) low = 0, offset = _high(++high, dim);
+      }
+    }
+  }
+
+private:
+  static constexpr unsigned primes[max_dim] = {
+    2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53
+  };
+  static constexpr DataType one_minus =
+    1 - std::numeric_limits<DataType>::epsilon() / 2;
+  static constexpr std::uint32_t max_period = 1 << 12;
+
+  static auto _power(unsigned base, unsigned k) -> DataType {
+    DataType result = 1;
+    while (k--) result /= base;
+    return result;
+  }
+
+  // The contribution of the higher digits from the low_digits-th one.
+  auto _high(std::uint32_t high, std::size_t dim) const -> DataType {
+    const unsigned base = primes[dim], first = low_digits_[dim];
+    const unsigned char* perm = &perms_[offsets_[dim]];
+    std::array<unsigned char, 32> digits;
+    unsigned k = first;
+    for (; high && k != digits_[dim]; ++k, high /= base)
+      digits[k - first] = perm[k * base + high % base];
+    // Horner's scheme from the least significant digit, starting from the
+    // permuted leading zeros.
+    DataType result = tails_[dim][k];
+    while (k-- != first) result = (digits[k - first] + result) / base;
+    return result * scales_[dim];
+  }
+
+  // Digit permutations of all dimensions and digits, stored contiguously.
+  std::vector<unsigned char> perms_;
+  std::array<std::size_t, max_dim> offsets_;
+  std::array<unsigned, max_dim> digits_;
+  std::array<std::array<DataType, 65>, max_dim> tails_;
+
+  // Tables of the lower digits.
+  std::array<std::vector<DataType>, max_dim> lows_;
+  std::array<unsigned, max_dim> low_digits_;
+  std::array<std::uint32_t, max_dim> periods_;
+  std::array<DataType, max_dim> scales_;
+};
+
+} // namespace qmc
+
+/**
+ * @brief The low-discrepancy sequences of @QmcSampler.
+ */
+enum class QmcSequence { sobol, halton };
+
+/**
+ * @brief The result of a randomized quasi-Monte Carlo estimation.
+ *  - value: the average of all independent replicates.
+ *  - error: the standard error of @value, estimated by the sample variance
+ *    of the replicates.
+ *  - points: the number of points evaluated in each replicate.
+ *  - converged: whether the tolerance is attained.
+ */
+template<class DataType = double>
+struct QmcEstimate {
+  DataType value, error;
+  std::size_t points;
+  bool converged;
+};
+
+/**
+ * Define the concept of shapes which @QmcSampler samples points from. A
+ * shape is either a @Rect, or a callback mapping the uniform coordinates
+ * (u, v) in [0, 1)^2 to a point uniformly distributed in the shape, i.e. a
+ * measure preserving map. The callback is invoked with simd vectors if it
+ * accepts them, otherwise once for each lane with scalars. Its result
+ * should be destructurable into two coordinates, e.g. @Point or std::pair.
+ */
+template<typename T, typename DataType>
+concept samplable = std::same_as<std::remove_cvref_t<T>, Rect<DataType> > ||
+    std::invocable<T&, DataType, DataType> ||
+    std::invocable<T&, const simd::native_t<DataType>&,
+                       const simd::native_t<DataType>&>;
+
+/**
+ * @brief A parallel randomized quasi-Monte Carlo engine for integrals over
+ *  the unit cube, in particular the expected distance between two
+ *  arbitrary shapes.
+ *
+ *  The integral is estimated by several independent replicates, each of
+ *  which averages the integrand over its own scrambled sequence. The
+ *  replicates are extended by doubling rounds (keeping the net structure
+ *  of Sobol points), and the standard error is estimated from the spread
+ *  of the replicates after each round. The process stops early once the
+ *  error is within the relative tolerance.
+ *
+ *  All replicates are split into chunks of consecutive points, which are
+ *  evaluated in parallel in simd batches. Since the streams are bound to
+ *  replicates rather than threads, and the chunks are reduced in a fixed
+ *  order, the results do not depend on the number of threads.
+ */
+template<class DataType = double>
+requires floating<DataType>
+class QmcSampler {
+public:
+  using value_type = simd::native_t<DataType>;
+  static constexpr std::size_t size() { return value_type::size(); }
+  static constexpr std::size_t max_dim = 16;
+
+  /**
+   * @brief Construct a sampler.
+   * @param tolerance the relative tolerance of the standard error.
+   * @param max_points the maximal number of points in each replicate. It is
+   *  rounded up to a multiple of the chunk size.
+   * @param sequence the low-discrepancy sequence.
+   * @param replicates the number of independent replicates (at least 2).
+   * @param seed the seed of randomizations.
+   */
+  explicit QmcSampler(DataType tolerance = 1e-4,
+                      std::size_t max_points = 1 << 20,
+                      QmcSequence sequence = QmcSequence::sobol,
+                      std::size_t replicates = 16,
+                      std::uint64_t seed = 0)
+      : tolerance_(tolerance),
+        max_points_(std::clamp<std::size_t>(
+          (max_points + chunk - 1) / chunk * chunk, chunk, 1ull << 32)),
+        sequence_(sequence),
+        replicates_(std::max<std::size_t>(replicates, 2)),
+        seed_(seed) { }
+
+  /**
+   * @brief Estimate the integral of @integrand over the unit cube.
+   * @tparam dim the dimension of the cube.
+   * @param integrand the function to be integrated, which should accept the
+   *  coordinates as `const std::array<value_type, dim>&` and return the
+   *  values of all lanes as `value_type`.
+   */
+  template<std::size_t dim, class Integrand>
+  requires (dim <= max_dim) && std::is_invocable_r_v<
+    value_type, Integrand&, const std::array<value_type, dim>&>
+  auto integrate(Integrand&& integrand) const -> QmcEstimate<DataType> {
+    if (sequence_ == QmcSequence::halton)
+      return _integrate<qmc::Halton<DataType>, dim>(integrand);
+    return _integrate<qmc::Sobol<DataType>, dim>(integrand);
+  }
+
+  /**
+   * @brief Estimate the expected distance between two points uniformly
+   *  selected from @lhs and @rhs respectively.
+   */
+  template<class Shape1, class Shape2>
+  requires samplable<Shape1, DataType> && samplable<Shape2, DataType>
+  auto expected_dist(Shape1&& lhs, Shape2&& rhs) const {
+    return integrate<4>([&](const std::array<value_type, 4>& u) {
+      auto [ x1, y1 ] = _sample(lhs, u[0], u[1]);
+      auto [ x2, y2 ] = _sample(rhs, u[2], u[3]);
+      value_type dx = x2 - x1, dy = y2 - y1;
+      return simd::sqrt(dx * dx + dy * dy);
+    });
+  }
+
+private:
+  // The number of consecutive points in a parallel task.
+  static constexpr std::size_t chunk = 1 << 10;
+
+  template<class Sequence, std::size_t dim, class Integrand>
+  auto _integrate(Integrand& integrand) const -> QmcEstimate<DataType> {
+    std::vector<Sequence> streams;
+    for (std::size_t r = 0; r != replicates_; ++r)
+      streams.emplace_back(qmc::detail::_mix(seed_ ^ (r << 32)));
+
+    std::vector<DataType> sums(replicates_, 0), partial;
+    QmcEstimate<DataType> result { 0, 0, 0, false };
+    for (std::size_t next = chunk; ; next = std::min(2 * next, max_points_)) {
+      // Evaluate the points in [points, next) of all replicates.
+      const std::size_t nchunks = (next - result.points) / chunk;
+      partial.assign(replicates_ * nchunks, 0);
+#pragma omp parallel for schedule(dynamic)
+      for (std::size_t task = 0; task < partial.size(); ++task) {
+        const Sequence& stream = streams[task / nchunks];
+        const std::size_t first = result.points + task % nchunks * chunk;
+        std::array<std::array<value_type, chunk / size()>, dim> points;
+        for (std::size_t j = 0; j != dim; ++j)
+          stream.generate(static_cast<std::uint32_t>(first), j, points[j]);
+        value_type sum = 0;
+        std::array<value_type, dim> u;
+        for (std::size_t i = 0; i != chunk / size(); ++i) {
+          for (std::size_t j = 0; j != dim; ++j) u[j] = points[j][i];
+          sum += integrand(u);
+        }
+        partial[task] = simd::stdx::reduce(sum);
+      }
+      for (std::size_t task = 0; task != partial.size(); ++task)
+        sums[task / nchunks] += partial[task];
+      result.points = next;
+
+      // The mean and standard error of the replicates.
+      DataType mean = 0, var = 0;
+      for (auto sum : sums) mean += sum / next;
+      mean /= replicates_;
+      for (auto sum : sums) var += (sum / next - mean) * (sum / next - mean);
+      result.value = mean;
+      result.error = std::sqrt(var / (replicates_ * (replicates_ - 1)));
+      result.converged = result.error <= tolerance_ * std::fabs(mean);
+      if (result.converged || next == max_points_) return result;
+    }
+  }
+
+  // Map the uniform coordinates into a shape.
+  template<class Shape>
+  static auto _sample(Shape& shape, const value_type& u, const value_type& v)
+      -> std::pair<value_type, value_type> {
+    if constexpr (std::same_as<std::remove_cvref_t<Shape>, Rect<DataType> >) {
+      auto [ w, h ] = shape.shape();
+      return { shape.x1() + u * w, shape.y1() + v * h };
+    } else if constexpr (std::invocable<Shape&, const value_type&,
+                                                const value_type&>) {
+      auto [ x, y ] = shape(u, v);
+      return { x, y };
+    } else {
+      std::array<DataType, size()> xs, ys;
+      for (std::size_t lane = 0; lane != size(); ++lane) {
+        auto [ x, y ] = shape(DataType(u[lane]), DataType(v[lane]));
+        xs[lane] = x, ys[lane] = y;
+      }
+      constexpr auto aligned = simd::stdx::element_aligned;
+      return { value_type(xs.data(), aligned), value_type(ys.data(), aligned) };
+    }
+  }
+
+  // Sampler settings.
+  DataType tolerance_;
+  std::size_t max_points_;
+  QmcSequence sequence_;
+  std::size_t replicates_;
+  std::uint64_t seed_;
+};
+
+/**
+ * @brief Estimate the expected distance between two rectangles by the
+ *  randomized quasi-Monte Carlo method. It is mainly a cross-check of the
+ *  closed representation, and the counterpart for arbitrary shapes is
+ *  @QmcSampler::expected_dist.
+ */
+template<class DataType>
+auto expected_dist(const Rect<DataType>& lhs, const Rect<DataType>& rhs,
+                   const QmcSampler<DataType>& sampler) {
+  return sampler.expected_dist(lhs, rhs);
+}
+
+} // namespace fiocca
+
+#endif // FIOCCA_EXPECTED_DIST_QMC_HPP_
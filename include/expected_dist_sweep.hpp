@@ -0,0 +1,434 @@
+#ifndef FIOCCA_EXPECTED_DIST_SWEEP_HPP_
+#define FIOCCA_EXPECTED_DIST_SWEEP_HPP_
+
+#include <span>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+#include <ranges>
+#include <type_traits>
+#include "rect.hpp"
+#include "simd.hpp"
+#include "expected_dist.hpp"
+#include "expected_dist_batch.hpp"
+
+namespace fiocca {
+
+/**
+ * @brief A regular lattice of translations, i.e. the offsets
+ *  (x0 + j * dx, y0 + i * dy) for 0 <= i < ny and 0 <= j < nx.
+ */
+template<class DataType>
+requires floating<DataType>
+struct SweepGrid {
+  constexpr auto size() const { return nx * ny; }
+
+  DataType x0, dx;
+  std::size_t nx;
+  DataType y0, dy;
+  std::size_t ny;
+};
+
+namespace detail {
+
+// Data-parallel counterpart of TwinRect::_asinh().
+template<class Simd>
+requires simd::vectorized<Simd>
+auto _sweep_asinh(const Simd& y, const Simd& x, const Simd& r) -> Simd {
+  Simd ay = simd::stdx::abs(y), ax = simd::stdx::abs(x), num = ay + r;
+  where(x == 0, num) = ay, where(x == 0, ax) = 1;
+  Simd result = simd::log(num / ax);
+  where(y < 0, result) = -result;
+  where(y == 0, result) = 0;
+  return result;
+}
+
+// The potential of r of order (kx, ky), i.e. the antiderivative taken kx
+// times in x and ky times in y, the counterpart of TwinRect::_inv_potential()
+// for the distance. The orders are shared by all lanes.
+template<class Simd>
+requires simd::vectorized<Simd>
+auto _dist_potential(int kx, int ky, const Simd& x, const Simd& y) -> Simd {
+  if (kx > ky) return _dist_potential(ky, kx, y, x);
+  Simd xsq = x * x, ysq = y * y, rsq = xsq + ysq, r = simd::sqrt(rsq);
+  switch (kx * 3 + ky) {
+    case 0: return r;
+    case 1: return (y * r + xsq * _sweep_asinh(y, x, r)) / 2;
+    case 2: return r * (ysq - 2 * xsq) / 6
+                 + xsq * y * _sweep_asinh(y, x, r) / 2;
+    case 4: return x * y * r / 3 + (x * xsq * _sweep_asinh(y, x, r)
+                                  + y * ysq * _sweep_asinh(x, y, r)) / 6;
+    case 5: return x * r * (3 * ysq - 2 * xsq) / 24
+                 + x * xsq * y * _sweep_asinh(y, x, r) / 6
+                 + ysq * ysq * _sweep_asinh(x, y, r) / 24;
+    default: return xsq * ysq * r / 12 - rsq * rsq * r / 60
+                  + (xsq * xsq * y * _sweep_asinh(y, x, r)
+                   + x * ysq * ysq * _sweep_asinh(x, y, r)) / 24;
+  }
+}
+
+} // namespace detail
+
+/**
+ * @brief The expected distances between a fixed rectangle and a moving one
+ *  translated over a regular lattice, e.g. a footprint slid across all
+ *  placements of a grid. Integrating by parts twice in each dimension as
+ *  TwinRect::invdist() does,
+ *      E = \sum_{k, l} s_k t_l P(coord0[k], coord1[l]) / factor,
+ *  where P is the potential with d^4 P / dx^2 dy^2 = r, and the stencil
+ *  (s_k, coord0[k]) only depends on the column of the lattice, (t_l,
+ *  coord1[l]) only on the row. The potentials are tabulated on the nodes
+ *  of a block of rows and shared by all cells of the block. Besides, the
+ *  breakpoints of different cells coincide if the sizes are multiples of
+ *  the steps, and such nodes are evaluated only once, which saves up to
+ *  16 potentials per cell. Otherwise the cells are evaluated by
+ *  @TwinRectSimd with lanes over columns, sharing the terms of the
+ *  x-dimension of each column and the ones of the y-dimension of each row,
+ *  and agree with the batch kernel exactly.
+ *
+ *  The potentials grow faster than the distances and cancel among the 16
+ *  stencil points, so the tabulated values are less accurate than the
+ *  closed representation, e.g. they deviate by up to 1.6e-10 relatively
+ *  in double from the batch kernel over the aligned 400 x 400 grid of
+ *  edist_sweep_example.
+ *
+ *  The cells far apart take the far-field expansion, see far_field_ratio,
+ *  and the potentials are only tabulated around the near cells. Since the
+ *  potentials cancel as the closed representation does, they are evaluated
+ *  in double for narrower precisions, see promotion_tolerance.
+ */
+template<class DataType = double>
+requires floating<DataType>
+class DistSweep {
+public:
+  using compute_t = std::conditional_t<
+    (sizeof(DataType) < sizeof(double)), double, DataType>;
+  using value_type = simd::native_t<compute_t>;
+
+  /**
+   * @brief Prepare the sweep of @moving over @grid against @fixed.
+   * @param block the number of rows sharing a table of potentials.
+   */
+  DistSweep(const Rect<DataType>& fixed, const Rect<DataType>& moving,
+            const SweepGrid<DataType>& grid, std::size_t block = 16)
+      : fixed_(_widen(fixed)), moving_(_widen(moving)),
+        grid_(grid), block_(std::max<std::size_t>(block, 1)) {
+    TwinRect<compute_t> twin_rect(fixed_, moving_);
+    factor_ = twin_rect.factor;
+    x_ = _axis(twin_rect._stencil(fixed_.w(), moving_.w(),
+                                  twin_rect.coord0, twin_rect.delta1),
+               grid.x0, grid.dx, grid.nx);
+    y_ = _axis(twin_rect._stencil(fixed_.h(), moving_.h(),
+                                  twin_rect.coord1, twin_rect.delta2),
+               grid.y0, grid.dy, grid.ny);
+    // The table evaluates about one potential per pair of classes in each
+    // cell, against one per pair of stencil points by the closed
+    // representation, which is as expensive as a potential.
+    tabulated_ = x_.classes * y_.classes < x_.size * y_.size;
+  }
+
+  // The number of cells of the raster.
+  auto size() const { return grid_.size(); }
+
+  /**
+   * @brief Evaluate the raster in parallel over blocks of rows.
+   * @param result the row-major output buffer of size nx * ny, where
+   *  result[i * nx + j] is the expected distance between @fixed and
+   *  @moving translated by (x0 + j * dx, y0 + i * dy).
+   */
+  void evaluate(std::span<DataType> result) const {
+    const std::size_t nblocks = (grid_.ny + block_ - 1) / block_;
+#pragma omp parallel for schedule(dynamic)
+    for (std::size_t b = 0; b < nblocks; ++b)
+      _evaluate_block(b * block_, std::min((b + 1) * block_, grid_.ny),
+                      result);
+  }
+
+private:
+  using Stencil = typename TwinRect<compute_t>::Stencil;
+
+  /**
+   * @brief The nodes of one axis, i.e. the breakpoints of the stencils of
+   *  all translations. The point k of the stencil of the n-th translation
+   *  is the node n + shift[k] of the class cls[k], whose value is
+   *  base[c] + node * step. Breakpoints coinciding up to rounding share a
+   *  class, and the nodes of class c range over [lo[c], count + hi[c]).
+   */
+  struct Axis {
+    int order;
+    std::size_t size, classes;
+    std::array<compute_t, 4> signs, base;
+    std::array<std::size_t, 4> cls;
+    std::array<std::ptrdiff_t, 4> shift, lo, hi;
+    compute_t step;
+  };
+
+  static auto _widen(const Rect<DataType>& rect) {
+    return Rect<compute_t>(rect.x1(), rect.x2(), rect.y1(), rect.y2());
+  }
+
+  static auto _axis(const Stencil& stencil, DataType origin, DataType step,
+                    std::size_t count) -> Axis {
+    constexpr compute_t snap = 64 * std::numeric_limits<compute_t>::epsilon();
+    Axis axis { stencil.order, stencil.size, 0, stencil.signs, { },
+                { }, { }, { }, { }, step };
+    for (std::size_t k = 0; k != axis.size; ++k) {
+      compute_t value = stencil.points[k] + compute_t(origin);
+      std::size_t c = 0;
+      for (; c != axis.classes; ++c) {
+        compute_t m = axis.step? std::round((value - axis.base[c])
+                                            / axis.step) : 0;
+        compute_t rest = value - (axis.base[c] + m * axis.step);
+        if (std::fabs(m) < compute_t(count) && std::fabs(rest) <= snap
+            * (std::fabs(value) + std::fabs(axis.base[c]))) {
+          axis.shift[k] = static_cast<std::ptrdiff_t>(m);
+          break;
+        }
+      }
+      if (c == axis.classes) {
+        axis.base[c] = value, axis.shift[k] = 0;
+        axis.lo[c] = axis.hi[c] = 0;
+        ++axis.classes;
+      }
+      axis.cls[k] = c;
+      axis.lo[c] = std::min(axis.lo[c], axis.shift[k]);
+      axis.hi[c] = std::max(axis.hi[c], axis.shift[k]);
+    }
+    return axis;
+  }
+
+  // Round up to a multiple of the simd width.
+  static constexpr auto _round(std::size_t n) {
+    constexpr std::size_t width = value_type::size();
+    return (n + width - 1) / width * width;
+  }
+
+  // The offset of the n-th translation of an axis, and the ones of the
+  // columns from @j in simd lanes.
+  static auto _offset(DataType origin, DataType step, std::size_t n) {
+    return compute_t(origin) + compute_t(n) * compute_t(step);
+  }
+
+  auto _offsets(std::size_t j) const -> value_type {
+    return value_type([&](auto lane) {
+      return _offset(grid_.x0, grid_.dx, j + lane);
+    });
+  }
+
+  // The number of nodes of the class @c for @count translations, and the
+  // value of the node @n.
+  static auto _count(const Axis& axis, std::size_t c, std::size_t count) {
+    return count + std::size_t(axis.hi[c] - axis.lo[c]);
+  }
+
+  static auto _node(const Axis& axis, std::size_t c, std::ptrdiff_t n) {
+    return axis.base[c] + compute_t(n) * axis.step;
+  }
+
+  // The rows [row0, row1) of the raster in evaluation, with the expected
+  // distances of the padded rows in @values.
+  struct Block {
+    std::vector<compute_t> values;
+    std::vector<unsigned char> near;
+    std::vector<std::size_t> begin, end;
+    std::size_t row0, row1;
+  };
+
+  // The nodes [first, last] of each class for the translations
+  // [begin, end), and the offsets of the classes in a row of the table.
+  struct Range {
+    std::array<std::ptrdiff_t, 4> first, offset;
+    std::size_t size;
+  };
+
+  static auto _range(const Axis& axis, std::size_t begin, std::size_t end)
+      -> Range {
+    Range range { { }, { }, 0 };
+    for (std::size_t c = 0; c != axis.classes; ++c) {
+      range.first[c] = std::ptrdiff_t(begin) + axis.lo[c];
+      range.offset[c] = std::ptrdiff_t(range.size);
+      range.size += _count(axis, c, end - begin);
+    }
+    return range;
+  }
+
+  // The column of the point k of the translation n in the table.
+  static auto _column(const Axis& axis, const Range& range, std::size_t k,
+                      std::size_t n) -> std::size_t {
+    std::size_t c = axis.cls[k];
+    return std::size_t(range.offset[c] + std::ptrdiff_t(n) + axis.shift[k]
+                       - range.first[c]);
+  }
+
+  void _evaluate_block(std::size_t row0, std::size_t row1,
+                       std::span<DataType> result) const {
+    constexpr std::size_t width = value_type::size();
+    constexpr auto aligned = simd::stdx::element_aligned;
+    const std::size_t nx = grid_.nx, padded = _round(nx);
+    auto [ w1, h1 ] = fixed_.shape();
+    auto [ w2, h2 ] = moving_.shape();
+
+    // The far-field expansion in the far cells, with lanes over columns,
+    // rounded in the same order as separation_ratio() at the threshold of
+    // DataType. The near cells are flagged, together with the range of
+    // their columns in each row.
+    Block block { std::vector<compute_t>((row1 - row0) * padded),
+                  std::vector<unsigned char>((row1 - row0) * padded),
+                  std::vector<std::size_t>(row1 - row0, nx),
+                  std::vector<std::size_t>(row1 - row0, 0), row0, row1 };
+    for (std::size_t i = row0; i != row1; ++i) {
+      compute_t oy = _offset(grid_.y0, grid_.dy, i);
+      value_type dy((moving_.y1() + oy) + (moving_.y2() + oy)
+                    - fixed_.y1() - fixed_.y2());
+      std::size_t& begin = block.begin[i - row0];
+      std::size_t& end = block.end[i - row0];
+      for (std::size_t j = 0; j < nx; j += width) {
+        value_type ox = _offsets(j);
+        value_type dx = (moving_.x1() + ox) + (moving_.x2() + ox)
+                      - fixed_.x1() - fixed_.x2();
+        auto is_far = simd::sqrt(detail::_separation_sq<value_type>(
+          w1, h1, w2, h2, dx, dy)) < far_field_ratio<DataType>;
+        std::size_t at = (i - row0) * padded + j;
+        if (simd::stdx::any_of(is_far)) {
+          value_type hx = dx / 2, hy = dy / 2;
+          detail::_far_field<value_type>(
+            hx, hy, simd::sqrt(hx * hx + hy * hy), w1, h1, w2, h2)
+            .first.copy_to(&block.values[at], aligned);
+        }
+        for (std::size_t lane = 0; lane != width && j + lane < nx; ++lane) {
+          block.near[at + lane] = !is_far[lane];
+          if (is_far[lane]) continue;
+          begin = std::min(begin, j + lane), end = std::max(end, j + lane + 1);
+        }
+      }
+    }
+
+    if (tabulated_) _tabulate(block);
+    else _direct(block);
+    for (std::size_t i = row0; i != row1; ++i)
+      for (std::size_t j = 0; j != nx; ++j)
+        result[i * nx + j] = static_cast<DataType>(
+          block.values[(i - row0) * padded + j]);
+  }
+
+  // Evaluate the near cells of @block by the potentials tabulated at the
+  // nodes of all near cells, with lanes over nodes and then over columns.
+  void _tabulate(Block& block) const {
+    constexpr std::size_t width = value_type::size();
+    constexpr auto aligned = simd::stdx::element_aligned;
+    const std::size_t rows = block.row1 - block.row0;
+    const std::size_t begin = *std::ranges::min_element(block.begin);
+    const std::size_t end = *std::ranges::max_element(block.end);
+    if (begin >= end) return;
+    const Range xr = _range(x_, begin, end);
+    const Range yr = _range(y_, block.row0, block.row1);
+    const std::size_t stride = _round(xr.size);
+
+    // The lanes beyond a class are overwritten by the next class (or the
+    // next row) later, and the last row is padded.
+    std::vector<compute_t> table(yr.size * stride + width);
+    for (std::size_t cy = 0; cy != y_.classes; ++cy)
+      for (std::size_t r = 0; r != _count(y_, cy, rows); ++r) {
+        const value_type y(_node(y_, cy, yr.first[cy] + std::ptrdiff_t(r)));
+        compute_t* row = &table[(yr.offset[cy] + r) * stride];
+        for (std::size_t cx = 0; cx != x_.classes; ++cx)
+          for (std::size_t n = 0; n < _count(x_, cx, end - begin);
+               n += width) {
+            value_type x([&](auto lane) {
+              return _node(x_, cx, xr.first[cx] + std::ptrdiff_t(n + lane));
+            });
+            detail::_dist_potential(x_.order, y_.order, x, y)
+              .copy_to(&row[xr.offset[cx] + n], aligned);
+          }
+      }
+
+    const std::size_t padded = _round(grid_.nx);
+    for (std::size_t i = block.row0; i != block.row1; ++i) {
+      const std::size_t at = (i - block.row0) * padded;
+      for (std::size_t j = block.begin[i - block.row0];
+           j < block.end[i - block.row0]; j += width) {
+        value_type sum = 0;
+        for (std::size_t k = 0; k != x_.size; ++k)
+          for (std::size_t l = 0; l != y_.size; ++l) {
+            std::size_t r = _column(y_, yr, l, i);
+            sum += x_.signs[k] * y_.signs[l] * value_type(
+              &table[r * stride + _column(x_, xr, k, j)], aligned);
+          }
+        sum /= factor_;
+        for (std::size_t lane = 0; lane != width
+             && j + lane < block.end[i - block.row0]; ++lane)
+          if (block.near[at + j + lane])
+            block.values[at + j + lane] = sum[lane];
+      }
+    }
+  }
+
+  // Evaluate the near cells of @block by @TwinRectSimd with lanes over the
+  // columns, where the breakpoints of different cells rarely coincide. The
+  // terms of the x-dimension, i.e. the breakpoints of each column and their
+  // squares, are computed once per block, and the terms of the y-dimension,
+  // i.e. the squares and logarithms at the breakpoints of the row, once per
+  // row. The far cells are already evaluated, and the lanes are aligned to
+  // the simd width so that all rows share the columns.
+  void _direct(Block& block) const {
+    using twin_type = TwinRectSimd<compute_t>;
+    constexpr std::size_t width = value_type::size();
+    const std::size_t padded = _round(grid_.nx);
+    const std::size_t begin = *std::ranges::min_element(block.begin);
+    const std::size_t end = *std::ranges::max_element(block.end);
+    if (begin >= end) return;
+    const std::size_t first = begin / width;
+    const value_type ax1(fixed_.x1()), ax2(fixed_.x2());
+    const value_type ay1(fixed_.y1()), ay2(fixed_.y2());
+    std::vector<typename twin_type::ColumnTerms> columns;
+    for (std::size_t j = first * width; j < end; j += width) {
+      value_type ox = _offsets(j);
+      columns.push_back(twin_type::column_terms(
+        ax1, ax2, moving_.x1() + ox, moving_.x2() + ox));
+    }
+    for (std::size_t i = block.row0; i != block.row1; ++i) {
+      if (block.begin[i - block.row0] >= block.end[i - block.row0]) continue;
+      const std::size_t at = (i - block.row0) * padded;
+      const compute_t oy = _offset(grid_.y0, grid_.dy, i);
+      const auto row = twin_type::row_terms(
+        ay1, ay2, value_type(moving_.y1() + oy), value_type(moving_.y2() + oy));
+      for (std::size_t j = block.begin[i - block.row0] / width * width;
+           j < block.end[i - block.row0]; j += width) {
+        value_type dist = twin_type(columns[j / width - first], row).dist();
+        for (std::size_t lane = 0; lane != width
+             && j + lane < block.end[i - block.row0]; ++lane)
+          if (block.near[at + j + lane])
+            block.values[at + j + lane] = dist[lane];
+      }
+    }
+  }
+
+  Rect<compute_t> fixed_, moving_;
+  SweepGrid<DataType> grid_;
+  std::size_t block_;
+  compute_t factor_;
+  Axis x_, y_;
+  // Whether the potentials are tabulated, see the constructor.
+  bool tabulated_;
+};
+
+/**
+ * @brief Calculate the expected distances between @fixed and @moving
+ *  translated over @grid into the row-major raster @result of size
+ *  nx * ny, see @DistSweep.
+ */
+template<class DataType>
+requires floating<DataType>
+void expected_dist_sweep(const Rect<DataType>& fixed,
+                         const Rect<DataType>& moving,
+                         const SweepGrid<DataType>& grid,
+                         std::span<DataType> result) {
+  DistSweep<DataType>(fixed, moving, grid).evaluate(result);
+}
+
+} // namespace fiocca
+
+#endif // FIOCCA_EXPECTED_DIST_SWEEP_HPP_
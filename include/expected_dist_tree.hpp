@@ -0,0 +1,357 @@
+#ifndef FIOCCA_EXPECTED_DIST_TREE_HPP_
+#define FIOCCA_EXPECTED_DIST_TREE_HPP_
+
+#include <span>
+#include <array>
+#include <cmath>
+#include <vector>
+#include <tuple>
+#include <ranges>
+#include <numeric>
+#include <algorithm>
+#include "rect.hpp"
+#include "expected_dist.hpp"
+#include "expected_dist_batch.hpp"
+
+namespace fiocca {
+
+namespace detail {
+
+// The central moments E[x ^ p * y ^ q] of a planar distribution for
+// p + q <= 4, stored at index p * 5 + q.
+template<class T>
+using Moments = std::array<T, 25>;
+
+inline constexpr int _binomial[5][5] = {
+  { 1 }, { 1, 1 }, { 1, 2, 1 }, { 1, 3, 3, 1 }, { 1, 4, 6, 4, 1 }
+};
+
+// The central moments of the uniform distribution in a w * h rectangle.
+template<class T>
+constexpr auto _rect_moments(T w, T h) -> Moments<T> {
+  Moments<T> m { };
+  m[0] = 1;
+  m[10] = w * w / 12, m[2] = h * h / 12, m[12] = w * w * h * h / 144;
+  m[20] = w * w * w * w / 80, m[4] = h * h * h * h / 80;
+  return m;
+}
+
+// The moments about the point shifted by -(dx, dy) from the center, i.e.
+// the moments of (x + dx, y + dy).
+template<class T>
+constexpr auto _shift_moments(const Moments<T>& m, T dx, T dy) -> Moments<T> {
+  std::array<T, 5> px { 1 }, py { 1 };
+  for (int k = 1; k != 5; ++k)
+    px[k] = px[k - 1] * dx, py[k] = py[k - 1] * dy;
+  Moments<T> result { };
+  for (int p = 0; p <= 4; ++p)
+    for (int q = 0; p + q <= 4; ++q)
+      for (int i = 0; i <= p; ++i)
+        for (int j = 0; j <= q; ++j)
+          result[p * 5 + q] += _binomial[p][i] * _binomial[q][j]
+                             * px[p - i] * py[q - j] * m[i * 5 + j];
+  return result;
+}
+
+// The moments of y - x for independent centered x and y.
+template<class T>
+constexpr auto _diff_moments(const Moments<T>& x, const Moments<T>& y)
+    -> Moments<T> {
+  Moments<T> result { };
+  for (int p = 0; p <= 4; ++p)
+    for (int q = 0; p + q <= 4; ++q)
+      for (int i = 0; i <= p; ++i)
+        for (int j = 0; j <= q; ++j)
+          result[p * 5 + q] += ((i + j) & 1 ? -1 : 1)
+                             * _binomial[p][i] * _binomial[q][j]
+                             * x[i * 5 + j] * y[(p - i) * 5 + (q - j)];
+  return result;
+}
+
+// The expectation of the product of linear forms c * x + d * y.
+template<class T, std::size_t n>
+constexpr auto _project(const Moments<T>& m,
+                        const std::array<std::pair<T, T>, n>& forms) -> T {
+  // Coefficients of x ^ (n - j) * y ^ j in the product.
+  std::array<T, n + 1> coeffs { 1 };
+  for (std::size_t k = 0; k != n; ++k) {
+    auto [ c, d ] = forms[k];
+    for (std::size_t j = k + 1; j; --j)
+      coeffs[j] = coeffs[j] * c + coeffs[j - 1] * d;
+    coeffs[0] *= c;
+  }
+  T result = 0;
+  for (std::size_t j = 0; j <= n; ++j)
+    result += coeffs[j] * m[(n - j) * 5 + j];
+  return result;
+}
+
+/**
+ * @brief The multipole expansion of E|R + u| in the separation R, where u
+ *  is a centered random displacement with moments @m. Decompose u = a * e +
+ *  b * e' along R and its normal, then
+ *      |R + u| = R + a + b^2 / 2R - a b^2 / 2R^2 + (4 a^2 b^2 - b^4) / 8R^3
+ *              + O(|u|^5 / R^4),
+ *  where E[a] vanishes. Unlike _far_field(), the odd moments are kept since
+ *  an aggregate of rectangles is not symmetric.
+ */
+template<class T>
+constexpr auto _multipole(T dx, T dy, const Moments<T>& m) -> T {
+  T r = math::sqrt(dx * dx + dy * dy), ex = dx / r, ey = dy / r;
+  std::pair<T, T> a { ex, ey }, b { -ey, ex };
+  T b2 = _project<T, 2>(m, { b, b });
+  T ab2 = _project<T, 3>(m, { a, b, b });
+  T a2b2 = _project<T, 4>(m, { a, a, b, b });
+  T b4 = _project<T, 4>(m, { b, b, b, b });
+  return r + (b2 - (ab2 - (4 * a2b2 - b4) / (4 * r)) / r) / (2 * r);
+}
+
+} // namespace detail
+
+/**
+ * @brief A Barnes-Hut tree to aggregate the (weighted) sums of expected
+ *  distances over a large set of rectangles, i.e.
+ *      sum(X) = sum_j w_j * E|X - Y_j|
+ *  for a rectangle X, where Y_j are the rectangles in the tree.
+ *
+ *  The rectangles are recursively bisected at the median of their centers
+ *  along the longer side of the bounding box. Each node stores the total
+ *  weight, the weighted centroid and the central moments (up to order 4) of
+ *  the mixture of its rectangles. A node is taken as one aggregate by the
+ *  multipole expansion of E|X - Y| if it is well separated from X, i.e.
+ *      (r_node + r_X) < theta * R,
+ *  where r_node and r_X are the radii around the centroids and R is the
+ *  distance between the centroids. Otherwise the node is opened. In the
+ *  leaves, the rectangles satisfying the same criterion take the far-field
+ *  expansion of rectangle pairs, and the others are evaluated exactly by
+ *  @TwinRectSimd. The truncation error is O(theta ^ 5) relative to the
+ *  distances, so @theta trades the accuracy for the speed.
+ */
+template<class DataType = double>
+requires floating<DataType>
+class DistTree {
+public:
+  using twin_type = TwinRectSimd<DataType>;
+  using value_type = typename twin_type::value_type;
+
+  /**
+   * @brief Build the tree from a range of rectangles.
+   * @param rects the range of @Rect<DataType> objects.
+   * @param weights the non-negative weights of rectangles, or empty for
+   *  unit weights.
+   * @param theta the opening parameter in (0, 1).
+   * @param leaf_size the maximal number of rectangles in a leaf.
+   */
+  template<std::ranges::input_range Range>
+  requires std::same_as<std::ranges::range_value_t<Range>, Rect<DataType> >
+  explicit DistTree(Range&& rects, std::span<const DataType> weights = { },
+                    DataType theta = 0.5, std::size_t leaf_size = 16)
+      : theta_(theta), leaf_size_(std::max<std::size_t>(leaf_size, 1)) {
+    std::vector<Rect<DataType> > input(std::ranges::begin(rects),
+                                       std::ranges::end(rects));
+    size_ = input.size();
+    order_.resize(size_);
+    std::iota(order_.begin(), order_.end(), 0);
+    if (size_) _build(input, weights, 0, size_);
+
+    // Coordinates and weights in the order of leaves, padded with zero
+    // weights to a multiple of the simd width.
+    const std::size_t padded = _round(size_);
+    x1_.resize(padded, 0), x2_.resize(padded, 1);
+    y1_.resize(padded, 0), y2_.resize(padded, 1);
+    w_.resize(padded, 0);
+    for (std::size_t k = 0; k != size_; ++k) {
+      const auto& rect = input[order_[k]];
+      x1_[k] = rect.x1(), x2_[k] = rect.x2();
+      y1_[k] = rect.y1(), y2_[k] = rect.y2();
+      w_[k] = weights.empty() ? 1 : weights[order_[k]];
+    }
+  }
+
+  // The number of rectangles.
+  auto size() const { return size_; }
+
+  // The opening parameter.
+  auto theta() const { return theta_; }
+  void theta(DataType theta) { theta_ = theta; }
+
+  /**
+   * @brief The weighted sum of expected distances from @target to all
+   *  rectangles in the tree.
+   */
+  auto sum(const Rect<DataType>& target) const -> DataType {
+    return size_ ? _sum(target, size_) : 0;
+  }
+
+  /**
+   * @brief The weighted sums of expected distances from each rectangle in
+   *  the tree to all the others, i.e. the term of itself is excluded. The
+   *  rectangles are evaluated in parallel.
+   * @param result the output buffer in the order of construction.
+   */
+  void sums(std::span<DataType> result) const {
+#pragma omp parallel for schedule(dynamic, 64)
+    for (std::size_t k = 0; k < size_; ++k)
+      result[order_[k]] = _sum(
+        Rect<DataType>(x1_[k], x2_[k], y1_[k], y2_[k]), k);
+  }
+
+private:
+  struct Node {
+    std::size_t begin, end, left, right;
+    DataType weight, radius;
+    Point<DataType> centroid;
+    detail::Moments<DataType> moments;
+  };
+
+  // Round up to a multiple of the simd width.
+  static constexpr auto _round(std::size_t n) {
+    constexpr std::size_t width = twin_type::size();
+    return (n + width - 1) / width * width;
+  }
+
+  // Build the subtree of the rectangles order_[begin, end), and return the
+  // index of its root. The children are merged into the moments of the
+  // parent by the parallel axis theorem.
+  auto _build(const std::vector<Rect<DataType> >& rects,
+              std::span<const DataType> weights,
+              std::size_t begin, std::size_t end) -> std::size_t {
+    const std::size_t index = nodes_.size();
+    nodes_.push_back({ begin, end, 0, 0 });
+    auto center = [&](std::size_t i, int axis) {
+      return axis ? rects[i].y1() + rects[i].y2()
+                  : rects[i].x1() + rects[i].x2();
+    };
+
+    // The components are either the rectangles or the children.
+    std::vector<std::tuple<DataType, Point<DataType>,
+                           detail::Moments<DataType> > > parts;
+    DataType x1 = rects[order_[begin]].x1(), x2 = rects[order_[begin]].x2();
+    DataType y1 = rects[order_[begin]].y1(), y2 = rects[order_[begin]].y2();
+    for (std::size_t k = begin; k != end; ++k) {
+      const auto& rect = rects[order_[k]];
+      x1 = std::min(x1, rect.x1()), x2 = std::max(x2, rect.x2());
+      y1 = std::min(y1, rect.y1()), y2 = std::max(y2, rect.y2());
+    }
+    if (end - begin <= leaf_size_) {
+      for (std::size_t k = begin; k != end; ++k) {
+        const auto& rect = rects[order_[k]];
+        auto [ w, h ] = rect.shape();
+        parts.emplace_back(weights.empty() ? 1 : weights[order_[k]],
+                           Point<DataType> { rect.x1() + w / 2,
+                                             rect.y1() + h / 2 },
+                           detail::_rect_moments(w, h));
+      }
+    } else {
+      const int axis = y2 - y1 > x2 - x1;
+      const std::size_t mid = begin + (end - begin) / 2;
+      std::nth_element(order_.begin() + begin, order_.begin() + mid,
+                       order_.begin() + end, [&](std::size_t i, std::size_t j) {
+                         return center(i, axis) < center(j, axis);
+                       });
+      std::size_t left = _build(rects, weights, begin, mid);
+      std::size_t right = _build(rects, weights, mid, end);
+      nodes_[index].left = left, nodes_[index].right = right;
+      for (std::size_t child : { left, right })
+        parts.emplace_back(nodes_[child].weight, nodes_[child].centroid,
+                           nodes_[child].moments);
+    }
+
+    Node& node = nodes_[index];
+    node.weight = 0, node.centroid = { 0, 0 }, node.moments = { };
+    for (const auto& [ w, c, m ] : parts) {
+      node.weight += w;
+      node.centroid.x += w * c.x, node.centroid.y += w * c.y;
+    }
+    if (node.weight > 0) {
+      node.centroid.x /= node.weight, node.centroid.y /= node.weight;
+      for (const auto& [ w, c, m ] : parts) {
+        auto shifted = detail::_shift_moments(
+          m, c.x - node.centroid.x, c.y - node.centroid.y);
+        for (std::size_t k = 0; k != shifted.size(); ++k)
+          node.moments[k] += w / node.weight * shifted[k];
+      }
+    }
+    // The radius of the bounding box around the centroid.
+    DataType rx = std::max(x2 - node.centroid.x, node.centroid.x - x1);
+    DataType ry = std::max(y2 - node.centroid.y, node.centroid.y - y1);
+    node.radius = std::hypot(rx, ry);
+    return index;
+  }
+
+  // Traverse the tree for a target rectangle, excluding the @self-th
+  // rectangle in the order of leaves.
+  auto _sum(const Rect<DataType>& target, std::size_t self) const
+      -> DataType {
+    constexpr std::size_t width = twin_type::size();
+    constexpr auto aligned = simd::stdx::element_aligned;
+    auto [ w, h ] = target.shape();
+    const Point<DataType> center { target.x1() + w / 2, target.y1() + h / 2 };
+    const DataType radius = std::hypot(w, h) / 2;
+    const auto moments = detail::_rect_moments(w, h);
+    const value_type ax1(target.x1()), ax2(target.x2());
+    const value_type ay1(target.y1()), ay2(target.y2());
+
+    DataType far_sum = 0;
+    value_type leaf_sum = 0;
+    std::vector<std::size_t> stack { 0 };
+    while (!stack.empty()) {
+      const Node& node = nodes_[stack.back()];
+      stack.pop_back();
+      if (!(node.weight > 0)) continue;
+      DataType dx = node.centroid.x - center.x;
+      DataType dy = node.centroid.y - center.y;
+      if (node.radius + radius < theta_ * std::hypot(dx, dy)) {
+        far_sum += node.weight * detail::_multipole(
+          dx, dy, detail::_diff_moments(moments, node.moments));
+      } else if (node.left) {
+        stack.push_back(node.left), stack.push_back(node.right);
+      } else {
+        // The rectangles in the leaf are separated by the same criterion,
+        // and the closed representation is only taken in the near lanes.
+        // The loads start at a multiple of the simd width, so that they stay
+        // within the padded arrays, and the lanes outside the leaf or of the
+        // excluded rectangle are masked by zero weights.
+        for (std::size_t k = node.begin / width * width; k < node.end;
+             k += width) {
+          value_type bx1(&x1_[k], aligned), bx2(&x2_[k], aligned);
+          value_type by1(&y1_[k], aligned), by2(&y2_[k], aligned);
+          value_type weight([&](auto lane) {
+            const std::size_t j = k + lane;
+            return j >= node.begin && j < node.end && j != self ? w_[j] : 0;
+          });
+          value_type bw = bx2 - bx1, bh = by2 - by1;
+          value_type bdx = (bx1 + bx2) / 2 - center.x;
+          value_type bdy = (by1 + by2) / 2 - center.y;
+          value_type r = simd::sqrt(bdx * bdx + bdy * bdy);
+          auto far_lanes = simd::sqrt(bw * bw + bh * bh) / 2 + radius
+                         < theta_ * r;
+          value_type dist = 0;
+          if (!simd::stdx::all_of(far_lanes))
+            dist = twin_type(ax1, ax2, ay1, ay2, bx1, bx2, by1, by2).dist();
+          if (simd::stdx::any_of(far_lanes))
+            where(far_lanes, dist) = detail::_far_field(
+              bdx, bdy, r, value_type(w), value_type(h), bw, bh).first;
+          leaf_sum += weight * dist;
+        }
+      }
+    }
+    return far_sum + simd::stdx::reduce(leaf_sum);
+  }
+
+  // Tree settings.
+  DataType theta_;
+  std::size_t size_, leaf_size_;
+
+  // Nodes of the tree, where nodes_[0] is the root.
+  std::vector<Node> nodes_;
+
+  // Indices of rectangles in the order of leaves, and their padded
+  // coordinates and weights in the same order.
+  std::vector<std::size_t> order_;
+  std::vector<DataType> x1_, x2_, y1_, y2_, w_;
+};
+
+} // namespace fiocca
+
+#endif // FIOCCA_EXPECTED_DIST_TREE_HPP_
@@ -0,0 +1,242 @@
+#ifndef FIOCCA_INSTRUMENT_HPP_
+#define FIOCCA_INSTRUMENT_HPP_
+
+#include <bit>
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <string_view>
+#include <type_traits>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * Hot-path instrumentation, compiled in only if FIOCCA_INSTRUMENT is
+ * defined (see the CMake option of the same name). Otherwise the probes
+ * expand to nothing, and the snapshots are all zeros.
+ *  - FIOCCA_PROBE(name) counts a call of the enclosing scope as
+ *    instrument::Probe::name, and its duration in cycles.
+ *  - FIOCCA_PROBE_ITERATIONS(n) adds n iterations to the probe of the
+ *    enclosing scope, e.g. the steps of an integrator.
+ */
+#ifdef FIOCCA_INSTRUMENT
+#define FIOCCA_PROBE(name) \
+  ::fiocca_instrument::ScopedProbe fiocca_probe_( \
+    ::fiocca_instrument::Probe::name)
+#define FIOCCA_PROBE_ITERATIONS(n) fiocca_probe_.iterations(n)
+#else
+#define FIOCCA_PROBE(name) static_cast<void>(0)
+#define FIOCCA_PROBE_ITERATIONS(n) static_cast<void>(0)
+#endif
+
+namespace fiocca {
+
+namespace instrument {
+
+inline constexpr bool enabled =
+#ifdef FIOCCA_INSTRUMENT
+  true;
+#else
+  false;
+#endif
+
+/**
+ * @brief The instrumented branches and integrators. The branches of
+ *  TwinRect::dist() are named after its comments, and the ones of dens()
+ *  and _idfint_dens() after the heights of the rectangles: both positive,
+ *  both zero, or exactly one of them positive.
+ */
+enum class Probe : std::size_t {
+  dist_far, dist_promoted, dist_case1, dist_case2, dist_case3,
+  dens_heights, dens_lines, dens_mixed,
+  int_dens_heights, int_dens_lines, int_dens_mixed,
+  trapezoid, simpson, romberg,
+  count
+};
+inline constexpr std::size_t probe_count =
+  static_cast<std::size_t>(Probe::count);
+
+constexpr auto probe_name(Probe probe) -> std::string_view {
+  constexpr std::string_view names[] = {
+    "dist/far", "dist/promoted", "dist/case1", "dist/case2", "dist/case3",
+    "dens/heights", "dens/lines", "dens/mixed",
+    "int_dens/heights", "int_dens/lines", "int_dens/mixed",
+    "trapezoid", "simpson", "romberg"
+  };
+  return names[static_cast<std::size_t>(probe)];
+}
+
+// The histogram of durations has a bucket for each bit width of the
+// number of cycles, i.e. bucket b counts durations in [2 ^ (b - 1), 2 ^ b).
+inline constexpr std::size_t buckets = 40;
+
+// Aggregated counters of a probe.
+struct ProbeStats {
+  std::uint64_t calls = 0, cycles = 0, iterations = 0;
+  std::array<std::uint64_t, buckets> histogram { };
+};
+using Snapshot = std::array<ProbeStats, probe_count>;
+
+namespace detail {
+
+// The time stamp counter, or nanoseconds where it is unavailable.
+inline auto _cycles() -> std::uint64_t {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+/**
+ * @brief The counters of a thread. Each thread only writes its own
+ *  counters, so that relaxed loads and stores suffice without any atomic
+ *  read-modify-write, and snapshots read them concurrently. A reset hence
+ *  never writes into the counters, but records them as the baseline that
+ *  the snapshots subtract, guarded by the mutex of the registry. The
+ *  counters of exited threads are folded into the retired ones.
+ */
+struct ThreadCounters {
+  struct Entry {
+    std::atomic<std::uint64_t> calls, cycles, iterations;
+    std::array<std::atomic<std::uint64_t>, buckets> histogram;
+  };
+
+  ThreadCounters();
+  ~ThreadCounters();
+
+  static void add(std::atomic<std::uint64_t>& counter, std::uint64_t n) {
+    counter.store(counter.load(std::memory_order_relaxed) + n,
+                  std::memory_order_relaxed);
+  }
+
+  void record(Probe probe, std::uint64_t cycles, std::uint64_t iterations) {
+    Entry& entry = entries[static_cast<std::size_t>(probe)];
+    add(entry.calls, 1), add(entry.cycles, cycles);
+    add(entry.iterations, iterations);
+    add(entry.histogram[std::min<std::size_t>(std::bit_width(cycles),
+                                              buckets - 1)], 1);
+  }
+
+  // Add the counts since the baseline to @snapshot.
+  void accumulate(Snapshot& snapshot) const {
+    auto load = [](const auto& counter) {
+      return counter.load(std::memory_order_relaxed);
+    };
+    for (std::size_t p = 0; p != probe_count; ++p) {
+      const ProbeStats& base = baseline[p];
+      snapshot[p].calls += load(entries[p].calls) - base.calls;
+      snapshot[p].cycles += load(entries[p].cycles) - base.cycles;
+      snapshot[p].iterations += load(entries[p].iterations)
+                              - base.iterations;
+      for (std::size_t b = 0; b != buckets; ++b)
+        snapshot[p].histogram[b] += load(entries[p].histogram[b])
+                                  - base.histogram[b];
+    }
+  }
+
+  // Move the baseline to the current counts.
+  void rebase() {
+    Snapshot counts { };
+    baseline = { };
+    accumulate(counts);
+    baseline = counts;
+  }
+
+  std::array<Entry, probe_count> entries { };
+  Snapshot baseline { };
+};
+
+// The registry of live threads and the counters of exited ones.
+struct Registry {
+  std::mutex mutex;
+  std::vector<ThreadCounters*> threads;
+  Snapshot retired { };
+};
+
+inline auto _registry() -> Registry& {
+  static Registry registry;
+  return registry;
+}
+
+inline ThreadCounters::ThreadCounters() {
+  Registry& registry = _registry();
+  std::lock_guard lock(registry.mutex);
+  registry.threads.push_back(this);
+}
+
+inline ThreadCounters::~ThreadCounters() {
+  Registry& registry = _registry();
+  std::lock_guard lock(registry.mutex);
+  accumulate(registry.retired);
+  std::erase(registry.threads, this);
+}
+
+inline void _record(Probe probe, std::uint64_t cycles,
+                    std::uint64_t iterations) {
+  thread_local ThreadCounters counters;
+  counters.record(probe, cycles, iterations);
+}
+
+} // namespace detail
+
+/**
+ * @brief A probe recording the enclosing scope on destruction, created by
+ *  FIOCCA_PROBE(). Nothing is recorded in constant evaluation, so that
+ *  the instrumented functions stay constexpr.
+ */
+class ScopedProbe {
+public:
+  constexpr explicit ScopedProbe(Probe probe) : probe_(probe) {
+    if (!std::is_constant_evaluated()) start_ = detail::_cycles();
+  }
+  ScopedProbe(const ScopedProbe&) = delete;
+  constexpr ~ScopedProbe() {
+    if (!std::is_constant_evaluated())
+      detail::_record(probe_, detail::_cycles() - start_, iterations_);
+  }
+
+  constexpr void iterations(std::uint64_t n) { iterations_ += n; }
+
+private:
+  Probe probe_;
+  std::uint64_t start_ = 0, iterations_ = 0;
+};
+
+/**
+ * @brief Aggregate the counters of all threads, including the exited ones.
+ *  Counters of running threads are read while being updated, so that the
+ *  snapshot may miss their latest calls.
+ */
+inline auto snapshot() -> Snapshot {
+  detail::Registry& registry = detail::_registry();
+  std::lock_guard lock(registry.mutex);
+  Snapshot result = registry.retired;
+  for (const auto* thread : registry.threads) thread->accumulate(result);
+  return result;
+}
+
+// Reset the counters of all threads, by moving their baselines.
+inline void reset() {
+  detail::Registry& registry = detail::_registry();
+  std::lock_guard lock(registry.mutex);
+  registry.retired = { };
+  for (auto* thread : registry.threads) thread->rebase();
+}
+
+} // namespace instrument
+
+} // namespace fiocca
+
+// The namespace of the probes under a name of its own, which the macros
+// expand to. The kernels of src/isa redefine the name fiocca to compile
+// the headers once per instruction set, while all their probes still
+// record into the single registry here.
+namespace fiocca_instrument = ::fiocca::instrument;
+
+#endif // FIOCCA_INSTRUMENT_HPP_
@@ -0,0 +1,51 @@
+#ifndef FIOCCA_KERNEL_TABLE_HPP_
+#define FIOCCA_KERNEL_TABLE_HPP_
+
+#include <cstddef>
+
+namespace fiocca {
+
+namespace dispatch {
+
+// The instruction sets for which the kernels are compiled into the library.
+enum class Isa { generic, sse2, avx2, avx512 };
+
+/**
+ * @brief The kernels compiled for one instruction set and one data type.
+ *  The signatures only involve plain pointers, so that the table is shared
+ *  by translation units compiled for different instruction sets, see
+ *  src/isa/kernels.cpp and the typed wrappers in expected_dist_dispatch.hpp.
+ */
+template<class DataType>
+struct Kernels {
+  // The integrand with its context.
+  using integrand_t = DataType (*)(DataType, void*);
+
+  // The expected distance of the coordinates (x1, x2, y1, y2) of the
+  // lefthand side rectangle followed by those of the righthand side one,
+  // with the tolerance of the closed representation.
+  DataType (*dist)(const DataType* coords, DataType tolerance);
+  // The expected distances of @size pairs given by eight columns of
+  // coordinates in the same order.
+  void (*dist_batch)(const DataType* const* columns, std::size_t size,
+                     DataType* result, DataType tolerance);
+  DataType (*trapezoid)(integrand_t integrand, void* context,
+                        DataType min, DataType max, std::size_t ngrid);
+  DataType (*simpson)(integrand_t integrand, void* context,
+                      DataType min, DataType max, std::size_t ngrid);
+  DataType (*romberg)(integrand_t integrand, void* context,
+                      DataType min, DataType max, DataType accuracy,
+                      std::size_t max_steps);
+};
+
+struct KernelTable {
+  Isa isa;
+  Kernels<float> f32;
+  Kernels<double> f64;
+};
+
+} // namespace dispatch
+
+} // namespace fiocca
+
+#endif // FIOCCA_KERNEL_TABLE_HPP_
@@ -0,0 +1,115 @@
+#ifndef FIOCCA_MATH_HPP_
+#define FIOCCA_MATH_HPP_
+
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <type_traits>
+#include "utility.hpp"
+
+namespace fiocca {
+
+namespace math {
+
+// The elementary functions of <cmath> are not constexpr until C++26. The
+// functions below are evaluated by portable series at compile time, and
+// simply forwarded to <cmath> at runtime so that the runtime results and
+// performance are not affected.
+
+namespace detail {
+
+// The wider type for the intermediate results at compile time.
+using wide_t = long double;
+
+// Split a positive finite @x = m * 2 ^ e with m in [1, 2), by multiplying
+// exact powers of two. The steps of 2 ^ 64 keep the loops short.
+constexpr auto _split(wide_t x) -> std::pair<wide_t, int> {
+  int e = 0;
+  for (; x >= 0x1p64L; e += 64) x *= 0x1p-64L;
+  for (; x < 0x1p-64L; e -= 64) x *= 0x1p64L;
+  for (; x >= 2; ++e) x /= 2;
+  for (; x < 1; --e) x *= 2;
+  return { x, e };
+}
+
+// Compute @x * 2 ^ e by multiplying exact powers of two.
+constexpr auto _scale(wide_t x, int e) -> wide_t {
+  for (; e >= 64; e -= 64) x *= 0x1p64L;
+  for (; e <= -64; e += 64) x *= 0x1p-64L;
+  for (; e > 0; --e) x *= 2;
+  for (; e < 0; ++e) x /= 2;
+  return x;
+}
+
+} // namespace detail
+
+/**
+ * @brief The absolute value. Negative zero is mapped to positive zero.
+ */
+template<class DataType>
+requires floating<DataType>
+constexpr auto fabs(DataType x) -> DataType {
+  if (!std::is_constant_evaluated()) return std::fabs(x);
+  return x < 0? -x : x + 0;
+}
+
+/**
+ * @brief The value of @x with the sign of @y. Note that the sign of zero is
+ *  not distinguished at compile time, i.e. -0 is regarded as positive.
+ */
+template<class DataType>
+requires floating<DataType>
+constexpr auto copysign(DataType x, DataType y) -> DataType {
+  if (!std::is_constant_evaluated()) return std::copysign(x, y);
+  return (y < 0) == (x < 0)? x : -x;
+}
+
+/**
+ * @brief The square root. At compile time, @x is split into m * 4 ^ k with
+ *  m in [1, 4), and sqrt(m) is approached by the Newton iterations from
+ *  (1 + m) / 2, which converge monotonically. Six iterations attain the
+ *  precision of the wider type.
+ */
+template<class DataType>
+requires floating<DataType>
+constexpr auto sqrt(DataType x) -> DataType {
+  if (!std::is_constant_evaluated()) return std::sqrt(x);
+  using limits = std::numeric_limits<DataType>;
+  if (x < 0) return limits::quiet_NaN();
+  if (!(x > 0 && x < limits::infinity())) return x;
+  auto [ m, e ] = detail::_split(x);
+  if (e & 1) m *= 2, --e;
+  detail::wide_t result = (1 + m) / 2;
+  for (int i = 0; i != 6; ++i) result = (result + m / result) / 2;
+  return static_cast<DataType>(detail::_scale(result, e / 2));
+}
+
+/**
+ * @brief The natural logarithm. At compile time, @x is split into m * 2 ^ e
+ *  with m in [sqrt(1/2), sqrt(2)), and log(m) = 2 * atanh(s) is summed by
+ *  its odd power series in s = (m - 1) / (m + 1) until the terms vanish.
+ *  This is the same reduction as simd::log().
+ */
+template<class DataType>
+requires floating<DataType>
+constexpr auto log(DataType x) -> DataType {
+  if (!std::is_constant_evaluated()) return std::log(x);
+  using limits = std::numeric_limits<DataType>;
+  if (x == 0) return -limits::infinity();
+  if (!(x > 0)) return limits::quiet_NaN();
+  if (x == limits::infinity()) return x;
+  constexpr detail::wide_t sqrt2 = 1.41421356237309504880168872420969808L;
+  constexpr detail::wide_t ln2 = 0.693147180559945309417232121458176568L;
+  auto [ m, e ] = detail::_split(x);
+  if (m > sqrt2) m /= 2, ++e;
+  detail::wide_t s = (m - 1) / (m + 1), z = s * s, power = s, sum = 0;
+  for (int k = 1; sum + power / k != sum; k += 2, power *= z)
+    sum += power / k;
+  return static_cast<DataType>(2 * sum + e * ln2);
+}
+
+} // namespace math
+
+} // namespace fiocca
+
+#endif // FIOCCA_MATH_HPP_
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <vector>
 #include "utility.hpp"
+#include "instrument.hpp"
 
 namespace fiocca {
 
@@ -47,6 +48,8 @@ requires integrable<Integrand, DataType>
 constexpr auto trapezoid(Integrand&& integrand,
                          DataType min, DataType max,
                          size_t ngrid = 1e+6) {
+  FIOCCA_PROBE(trapezoid);
+  FIOCCA_PROBE_ITERATIONS(ngrid);
   DataType delta = (max - min) / ngrid;
   DataType sum = (integrand(min) + integrand(max)) * delta / 2;
 #pragma omp parallel for reduction (+:sum)
@@ -95,6 +98,8 @@ requires integrable<Integrand, DataType>
 constexpr auto simpson(Integrand&& integrand,
                        DataType min, DataType max,
                        size_t ngrid = 1e+6) {
+  FIOCCA_PROBE(simpson);
+  FIOCCA_PROBE_ITERATIONS(ngrid);
   DataType sum = 0;
   DataType delta = (max - min) / ngrid;
 #pragma omp parallel for reduction (+:sum)
@@ -124,6 +129,8 @@ auto romberg(Integrand&& integrand,
              DataType min, DataType max,
              DataType accuracy = static_cast<DataType>(1e-11),
              size_t max_steps = 32) {
+  // The iterations are the refinement steps taken.
+  FIOCCA_PROBE(romberg);
   // Buffers for initialization of romberg series.
   std::vector<DataType> pre_row(max_steps), cur_row(max_steps);
   DataType h = max - min;
@@ -147,13 +154,16 @@ auto romberg(Integrand&& integrand,
       cur_row[j + 1] = cur_row[j] + (cur_row[j] - pre_row[j]) / factor;
     }
     // Return the result if the accuracy is qualified.
-    if (i > 1 && std::fabs(pre_row[i - 1] - cur_row[i]) < accuracy)
+    if (i > 1 && std::fabs(pre_row[i - 1] - cur_row[i]) < accuracy) {
+      FIOCCA_PROBE_ITERATIONS(i);
       return cur_row[i - 1];
+    }
 
     // Swap previous and current rows as we only need the last row.
     // Note that this is an O(1) operation.
     std::swap(pre_row, cur_row);
   }
+  FIOCCA_PROBE_ITERATIONS(max_steps - 1);
   return pre_row.back();
 }
 
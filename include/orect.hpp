@@ -0,0 +1,85 @@
+#ifndef FIOCCA_ORECT_HPP_
+#define FIOCCA_ORECT_HPP_
+
+#include <array>
+#include <cmath>
+#include "point.hpp"
+#include "rect.hpp"
+
+namespace fiocca {
+
+/**
+ * @brief An oriented rectangle, i.e. a rectangle rotated by @angle around
+ *  its center, the counterpart of @Rect at arbitrary angles. The axes of
+ *  the rectangle are u = (cos(angle), sin(angle)) and v = (-sin(angle),
+ *  cos(angle)), along which the half-extents are half_w and half_h. Line
+ *  segments and points are the rectangles with zero half-extents.
+ */
+template<class DataType>
+class ORect {
+public:
+  // Default constructor with no argument/the center, the half-extents and
+  // the angle in radians.
+  constexpr ORect() : ctr({ 0, 0 }), hw(0), hh(0), theta(0) { }
+  constexpr ORect(const Point<DataType>& center, DataType half_w,
+                  DataType half_h, DataType angle = 0)
+      : ctr(center), hw(half_w < 0? -half_w : half_w),
+        hh(half_h < 0? -half_h : half_h), theta(angle) {
+    // Make sure the half-extents are non-negative as @Rect does.
+  }
+
+  // Construct an oriented rectangle from an axis-aligned one.
+  constexpr explicit ORect(const Rect<DataType>& rect)
+      : ORect({ (rect.x1() + rect.x2()) / 2, (rect.y1() + rect.y2()) / 2 },
+              rect.w() / 2, rect.h() / 2) { }
+
+  // The line segment from @p to @q, along the u axis.
+  static auto segment(const Point<DataType>& p, const Point<DataType>& q) {
+    DataType dx = q.x - p.x, dy = q.y - p.y;
+    return ORect({ (p.x + q.x) / 2, (p.y + q.y) / 2 },
+                 std::hypot(dx, dy) / 2, 0, std::atan2(dy, dx));
+  }
+
+  // Attribute accessors.
+  constexpr const auto& center() const { return ctr; }
+  constexpr auto half_w() const { return hw; }
+  constexpr auto half_h() const { return hh; }
+  constexpr auto angle() const { return theta; }
+
+  // The unit axes along the width and the height.
+  auto u() const { return Point<DataType> { std::cos(theta),
+                                            std::sin(theta) }; }
+  auto v() const { return Point<DataType> { -std::sin(theta),
+                                            std::cos(theta) }; }
+
+  // The four corners counterclockwise from -u - v.
+  auto corners() const {
+    auto [ ux, uy ] = u().pair();
+    Point<DataType> a { hw * ux, hw * uy }, b { -hh * uy, hh * ux };
+    return std::array<Point<DataType>, 4> {
+      ctr - a - b, ctr + a - b, ctr + a + b, ctr - a + b
+    };
+  }
+
+  // Shape calculators.
+  constexpr auto w() const { return 2 * hw; }
+  constexpr auto h() const { return 2 * hh; }
+  constexpr auto shape() const { return std::make_pair(2 * hw, 2 * hh); }
+
+  // Other geometric attributes.
+  constexpr auto area() const { return 4 * hw * hh; }
+  constexpr auto peri() const { return 4 * (hw + hh); }
+  auto diam() const { return 2 * std::hypot(hw, hh); }
+
+  // Whether the rectangle degenerates into a line segment or a point.
+  constexpr auto is_segment() const { return !hw || !hh; }
+
+protected:
+  // The center, the half-extents along the axes and the angle of u.
+  Point<DataType> ctr;
+  DataType hw, hh, theta;
+};
+
+} // namespace fiocca
+
+#endif // FIOCCA_ORECT_HPP_
@@ -4,6 +4,8 @@
 
 #include <cmath>
 #include <array>
+#include <tuple>
+#include <utility>
 #include <type_traits>
 #include <functional>
 
@@ -77,6 +79,60 @@ dominate(const Point<DataType>& lhs, const Point<DataType>& rhs) {
   return lhs.x >= rhs.x && lhs.y >= rhs.y;
 }
 
+/**
+ * @brief Three-dimensional point struct, as public as @Point.
+ */
+template<class DataType>
+struct Point3 {
+  using type = DataType;
+  static constexpr std::size_t dim() { return 3; }
+
+  // Convert to a standard tuple struct.
+  constexpr auto tuple() const { return std::make_tuple(x, y, z); }
+
+  // Whether all components are larger than those of another point.
+  constexpr auto dominate(const Point3& p) {
+    return this->x >= p.x && this->y >= p.y && this->z >= p.z;
+  }
+
+  constexpr auto& operator[](std::size_t index) {
+    return index == 0? x : index == 1? y : z;
+  }
+  constexpr const auto& operator[](std::size_t index) const {
+    return index == 0? x : index == 1? y : z;
+  }
+
+  // Three-dimensional coordinates.
+  DataType x, y, z;
+};
+
+template<class DataType>
+inline constexpr auto
+operator+(const Point3<DataType>& lhs, const Point3<DataType>& rhs) {
+  return Point3<DataType> { lhs.x + rhs.x, lhs.y + rhs.y, lhs.z + rhs.z };
+}
+template<class DataType>
+inline constexpr auto
+operator-(const Point3<DataType>& lhs, const Point3<DataType>& rhs) {
+  return Point3<DataType> { lhs.x - rhs.x, lhs.y - rhs.y, lhs.z - rhs.z };
+}
+template<class DataType>
+inline constexpr auto
+operator+=(Point3<DataType>& lhs, const Point3<DataType>& rhs) {
+  lhs.x += rhs.x, lhs.y += rhs.y, lhs.z += rhs.z;
+}
+template<class DataType>
+inline constexpr auto
+operator-=(Point3<DataType>& lhs, const Point3<DataType>& rhs) {
+  lhs.x -= rhs.x, lhs.y -= rhs.y, lhs.z -= rhs.z;
+}
+
+template<class DataType>
+inline constexpr auto
+dominate(const Point3<DataType>& lhs, const Point3<DataType>& rhs) {
+  return lhs.x >= rhs.x && lhs.y >= rhs.y && lhs.z >= rhs.z;
+}
+
 // Template type alias.
 using Point2b = Point<unsigned char>;
 using Point2s = Point<short>;
@@ -85,6 +141,9 @@ using Point2i = Point<int>;
 using Point2u = Point<unsigned int>;
 using Point2f = Point<float>;
 using Point2d = Point<double>;
+using Point3i = Point3<int>;
+using Point3f = Point3<float>;
+using Point3d = Point3<double>;
 
 } // namespace fiocca
 
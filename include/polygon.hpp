@@ -0,0 +1,246 @@
+#ifndef FIOCCA_POLYGON_HPP_
+#define FIOCCA_POLYGON_HPP_
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include "point.hpp"
+#include "rect.hpp"
+
+namespace fiocca {
+
+/**
+ * @brief A simple rectilinear polygon, i.e. all edges are axis-parallel,
+ *  such as the L, U and T shapes. Holes are not supported.
+ *  The polygon is partitioned into the minimal number of rectangles once
+ *  it is constructed, so that the calculations upon it are reduced to the
+ *  rectangles without decomposing the polygon again.
+ */
+template<class DataType>
+requires floating<DataType>
+class RectilinearPolygon {
+public:
+  /**
+   * @brief Construct the polygon from its vertices in either orientation.
+   *  Consecutive vertices (including the last and the first ones) should
+   *  share a coordinate, and collinear vertices are allowed.
+   * @throw std::invalid_argument if an edge is not axis-parallel.
+   */
+  explicit RectilinearPolygon(std::vector<Point<DataType> > vertices)
+      : vertices_(std::move(vertices)) {
+    for (std::size_t i = 0; i != vertices_.size(); ++i) {
+      const auto& p = vertices_[i];
+      const auto& q = vertices_[(i + 1) % vertices_.size()];
+      if (p.x != q.x && p.y != q.y)
+        throw std::invalid_argument("the polygon is not rectilinear.");
+    }
+    _decompose();
+  }
+
+  // Construct the polygon of a rectangle.
+  explicit RectilinearPolygon(const Rect<DataType>& rect)
+      : vertices_({ rect.bl(), rect.br(), rect.tr(), rect.tl() }),
+        rects_({ rect }), area_(rect.area()) { }
+
+  // Attribute accessors.
+  const auto& vertices() const { return vertices_; }
+  const auto& rects() const { return rects_; }
+  auto area() const { return area_; }
+
+private:
+  /**
+   * @brief Partition the polygon into the minimal number of rectangles. The
+   *  classical construction cuts the polygon along a maximum set of pairwise
+   *  disjoint chords, i.e. the axis-parallel segments joining two reflex
+   *  vertices, and then cuts once from each reflex vertex left until hitting
+   *  the boundary or a previous cut. The maximum set of chords is the
+   *  maximum independent set of the bipartite graph of intersecting
+   *  horizontal and vertical chords (Konig's theorem).
+   *
+   *  All cuts lie on the grid induced by the coordinates of vertices, so the
+   *  polygon is represented by the cells of this grid, and the rectangles
+   *  are the connected components of cells separated by the cuts.
+   */
+  void _decompose() {
+    std::vector<DataType> xs, ys;
+    for (const auto& [ x, y ] : vertices_) xs.push_back(x), ys.push_back(y);
+    for (auto* coords : { &xs, &ys }) {
+      std::sort(coords->begin(), coords->end());
+      coords->erase(std::unique(coords->begin(), coords->end()),
+                    coords->end());
+    }
+    const long nx = static_cast<long>(xs.size()) - 1;
+    const long ny = static_cast<long>(ys.size()) - 1;
+    if (nx < 1 || ny < 1) return;
+
+    // Whether each cell is inside, by casting a ray to the right of its
+    // center and counting the vertical edges crossed.
+    std::vector<char> inside(nx * ny, 0);
+    for (long i = 0; i != nx; ++i)
+      for (long j = 0; j != ny; ++j) {
+        DataType cx = (xs[i] + xs[i + 1]) / 2, cy = (ys[j] + ys[j + 1]) / 2;
+        bool odd = false;
+        for (std::size_t k = 0; k != vertices_.size(); ++k) {
+          const auto& p = vertices_[k];
+          const auto& q = vertices_[(k + 1) % vertices_.size()];
+          if (p.x == q.x && p.x > cx && (p.y < cy) != (q.y < cy)) odd = !odd;
+        }
+        inside[i * ny + j] = odd;
+      }
+    auto in = [&](long i, long j) {
+      return i >= 0 && j >= 0 && i < nx && j < ny && inside[i * ny + j];
+    };
+
+    // Cuts along the grid segments. The vertical segment (i, j) lies on
+    // x = xs[i] between ys[j] and ys[j + 1], and the horizontal segment
+    // (i, j) on y = ys[j] between xs[i] and xs[i + 1].
+    std::vector<char> vcut((nx + 1) * ny, 0), hcut(nx * (ny + 1), 0);
+    auto interior = [&](bool horizontal, long i, long j) {
+      return horizontal ? in(i, j - 1) && in(i, j) : in(i - 1, j) && in(i, j);
+    };
+    auto cut = [&](bool horizontal, long i, long j) -> char& {
+      return horizontal ? hcut[i * (ny + 1) + j] : vcut[i * ny + j];
+    };
+
+    // The reflex vertices are the grid points with three inner cells. Their
+    // interior directions point away from the outer cell.
+    struct Reflex { long i, j, dx, dy; bool resolved; };
+    std::vector<Reflex> reflexes;
+    std::vector<long> reflex_at((nx + 1) * (ny + 1), -1);
+    for (long i = 0; i <= nx; ++i)
+      for (long j = 0; j <= ny; ++j) {
+        bool ll = in(i - 1, j - 1), lr = in(i, j - 1);
+        bool ul = in(i - 1, j), ur = in(i, j);
+        if (ll + lr + ul + ur != 3) continue;
+        reflex_at[i * (ny + 1) + j] = reflexes.size();
+        reflexes.push_back({ i, j, lr && ur ? 1 : -1, ul && ur ? 1 : -1,
+                             false });
+      }
+
+    // Walk from a grid point along the interior of a direction, and return
+    // the number of steps to the first reflex vertex, or zero if it hits
+    // the boundary before.
+    struct Chord { long i, j, steps; bool horizontal; };
+    std::vector<Chord> hchords, vchords;
+    auto walk = [&](long i, long j, long dx, long dy) -> long {
+      for (long steps = 1; ; ++steps) {
+        long si = dx < 0 ? i - 1 : i, sj = dy < 0 ? j - 1 : j;
+        if (!interior(dy == 0, si, sj)) return 0;
+        i += dx, j += dy;
+        if (reflex_at[i * (ny + 1) + j] >= 0) return steps;
+      }
+    };
+    for (const auto& [ i, j, dx, dy, resolved ] : reflexes) {
+      // Each chord is recorded from its lower endpoint.
+      if (long steps = dx > 0 ? walk(i, j, 1, 0) : 0)
+        hchords.push_back({ i, j, steps, true });
+      if (long steps = dy > 0 ? walk(i, j, 0, 1) : 0)
+        vchords.push_back({ i, j, steps, false });
+    }
+
+    // The maximum matching of intersecting chords (Kuhn's algorithm).
+    auto intersect = [&](const Chord& h, const Chord& v) {
+      return h.i <= v.i && v.i <= h.i + h.steps &&
+             v.j <= h.j && h.j <= v.j + v.steps;
+    };
+    const std::size_t nh = hchords.size(), nv = vchords.size();
+    std::vector<long> hmatch(nh, -1), vmatch(nv, -1);
+    std::vector<char> hvisited(nh), vvisited(nv);
+    auto augment = [&](auto&& self, std::size_t h) -> bool {
+      for (std::size_t v = 0; v != nv; ++v) {
+        if (vvisited[v] || !intersect(hchords[h], vchords[v])) continue;
+        vvisited[v] = true;
+        if (vmatch[v] < 0 || self(self, vmatch[v])) {
+          hmatch[h] = v, vmatch[v] = h;
+          return true;
+        }
+      }
+      return false;
+    };
+    for (std::size_t h = 0; h != nh; ++h) {
+      std::fill(vvisited.begin(), vvisited.end(), false);
+      augment(augment, h);
+    }
+
+    // The maximum independent set consists of the horizontal chords
+    // reachable from the unmatched ones by alternating paths, and the
+    // vertical chords unreachable.
+    std::fill(vvisited.begin(), vvisited.end(), false);
+    auto reach = [&](auto&& self, std::size_t h) -> void {
+      hvisited[h] = true;
+      for (std::size_t v = 0; v != nv; ++v)
+        if (!vvisited[v] && intersect(hchords[h], vchords[v])) {
+          vvisited[v] = true;
+          if (vmatch[v] >= 0 && !hvisited[vmatch[v]]) self(self, vmatch[v]);
+        }
+    };
+    for (std::size_t h = 0; h != nh; ++h)
+      if (hmatch[h] < 0 && !hvisited[h]) reach(reach, h);
+    auto apply = [&](const Chord& chord) {
+      auto [ i, j, steps, horizontal ] = chord;
+      for (long k = 0; k != steps; ++k)
+        cut(horizontal, horizontal ? i + k : i, horizontal ? j : j + k) = true;
+      long ei = horizontal ? i + steps : i, ej = horizontal ? j : j + steps;
+      reflexes[reflex_at[i * (ny + 1) + j]].resolved = true;
+      reflexes[reflex_at[ei * (ny + 1) + ej]].resolved = true;
+    };
+    for (std::size_t h = 0; h != nh; ++h) if (hvisited[h]) apply(hchords[h]);
+    for (std::size_t v = 0; v != nv; ++v) if (!vvisited[v]) apply(vchords[v]);
+
+    // Cut vertically from each remaining reflex vertex until hitting the
+    // boundary or a horizontal cut.
+    for (auto& reflex : reflexes) {
+      if (reflex.resolved) continue;
+      reflex.resolved = true;
+      for (long i = reflex.i, j = reflex.j, dy = reflex.dy; ; ) {
+        long sj = dy < 0 ? j - 1 : j;
+        if (!interior(false, i, sj)) break;
+        cut(false, i, sj) = true;
+        j += dy;
+        if ((i > 0 && cut(true, i - 1, j)) || (i < nx && cut(true, i, j)))
+          break;
+        if (long k = reflex_at[i * (ny + 1) + j]; k >= 0)
+          reflexes[k].resolved = true;
+      }
+    }
+
+    // Collect the connected components of cells, which are rectangles.
+    std::vector<char> visited(nx * ny, 0);
+    std::vector<std::pair<long, long> > stack;
+    for (long i0 = 0; i0 != nx; ++i0)
+      for (long j0 = 0; j0 != ny; ++j0) {
+        if (!in(i0, j0) || visited[i0 * ny + j0]) continue;
+        long imin = i0, imax = i0, jmin = j0, jmax = j0;
+        visited[i0 * ny + j0] = true;
+        stack.assign(1, { i0, j0 });
+        while (!stack.empty()) {
+          auto [ i, j ] = stack.back();
+          stack.pop_back();
+          imin = std::min(imin, i), imax = std::max(imax, i);
+          jmin = std::min(jmin, j), jmax = std::max(jmax, j);
+          auto visit = [&](long ni, long nj, bool blocked) {
+            if (blocked || !in(ni, nj) || visited[ni * ny + nj]) return;
+            visited[ni * ny + nj] = true;
+            stack.emplace_back(ni, nj);
+          };
+          visit(i - 1, j, cut(false, i, j));
+          visit(i + 1, j, cut(false, i + 1, j));
+          visit(i, j - 1, cut(true, i, j));
+          visit(i, j + 1, cut(true, i, j + 1));
+        }
+        rects_.emplace_back(xs[imin], xs[imax + 1], ys[jmin], ys[jmax + 1]);
+        area_ += rects_.back().area();
+      }
+  }
+
+  // The boundary of the polygon.
+  std::vector<Point<DataType> > vertices_;
+
+  // The minimal partition into rectangles, and the total area.
+  std::vector<Rect<DataType> > rects_;
+  DataType area_ = 0;
+};
+
+} // namespace fiocca
+
+#endif // FIOCCA_POLYGON_HPP_
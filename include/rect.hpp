@@ -18,8 +18,8 @@ public:
   // Default constructor with no argument/four coordinates.
   constexpr Rect() : p1({ 0, 0 }), p2({ 0, 0 }) { }
   constexpr Rect(DataType x1_, DataType x2_, DataType y1_, DataType y2_)
-      : p1({ std::min(x1_, x2_), std::max(x1_, x2_) }),
-        p2({ std::min(y1_, y2_), std::max(y1_, y2_) }) {
+      : p1({ std::min(x1_, x2_), std::min(y1_, y2_) }),
+        p2({ std::max(x1_, x2_), std::max(y1_, y2_) }) {
     // To simplify the calculation process and avoid mistakes,
     // here we need to make sure x1 <= x2 and y1 <= y2.
   }
@@ -27,8 +27,8 @@ public:
   // Construct rectangle from bottom left and top right points.
   constexpr Rect(const Point<DataType>& p1_, const Point<DataType>& p2_) {
     // Check range of input. Swap coordinates if illegal.
-    p1 = { std::min(p1_.x, p2.x), std::min(p1_.y, p2_.y) };
-    p2 = { std::max(p1_.x, p2.x), std::max(p1_.y, p2_.y) };
+    p1 = { std::min(p1_.x, p2_.x), std::min(p1_.y, p2_.y) };
+    p2 = { std::max(p1_.x, p2_.x), std::max(p1_.y, p2_.y) };
   }
 
   // Attribute accessors/mutators.
@@ -0,0 +1,129 @@
+#ifndef FIOCCA_SIMD_HPP_
+#define FIOCCA_SIMD_HPP_
+
+#include <experimental/simd>
+#include <cmath>
+#include <limits>
+#include <cstdint>
+#include "utility.hpp"
+
+namespace fiocca {
+
+namespace simd {
+
+// The data-parallel types are still experimental in C++20. We use the
+// libstdc++ implementation (Parallelism TS v2) and alias it for brevity.
+namespace stdx = std::experimental;
+
+/**
+ * Define the concept of vectorized floating types, i.e. the simd type
+ * whose element type satisfies the concept @floating.
+ */
+template<typename T>
+concept vectorized = stdx::is_simd_v<T> &&
+    floating<typename T::value_type>;
+
+// The widest simd type supported by the target instruction set.
+template<class DataType>
+requires floating<DataType>
+using native_t = stdx::native_simd<DataType>;
+
+/**
+ * @brief The element-wise square root. The libstdc++ implementation
+ *  already maps it to the hardware square root instructions.
+ */
+template<class Simd>
+requires vectorized<Simd>
+inline auto sqrt(const Simd& x) -> Simd { return stdx::sqrt(x); }
+
+/**
+ * @brief The element-wise natural logarithm.
+ *  The libstdc++ implementation of `log` falls back to a scalar call for
+ *  each lane, which ruins the throughput of the batched kernels. Instead
+ *  we split @x = m * 2^e with m in [sqrt(1/2), sqrt(2)) by manipulating
+ *  the IEEE-754 representation directly, and evaluate
+ *      log(m) = 2 * atanh(s),    s = (m - 1) / (m + 1),
+ *  by its odd power series. Since |s| < 0.1716, the truncated series
+ *  attains the machine precision of @DataType with a few terms.
+ * @param x the input simd vector.
+ * @return the logarithm of each lane. Zero lanes are mapped to -inf and
+ *  negative lanes to NaN, the same as std::log.
+ */
+template<class Simd>
+requires vectorized<Simd> &&
+    (sizeof(typename Simd::value_type) <= sizeof(double))
+inline auto log(const Simd& x) -> Simd {
+  using DataType = typename Simd::value_type;
+  using limits = std::numeric_limits<DataType>;
+  using Integer = std::conditional_t<
+    sizeof(DataType) == sizeof(float), std::uint32_t, std::uint64_t>;
+  using IntSimd = stdx::rebind_simd_t<Integer, Simd>;
+  static_assert(sizeof(DataType) == sizeof(Integer),
+                "only IEEE-754 single/double precision are vectorized.");
+
+  // Layout of the IEEE-754 representation.
+  constexpr int digits = limits::digits - 1;
+  constexpr Integer bias = limits::max_exponent - 2;
+  constexpr Integer mantissa_mask = (Integer(1) << digits) - 1;
+  constexpr DataType magic = DataType(Integer(1) << digits);
+  constexpr DataType sqrt_half = 0.70710678118654752440;
+  constexpr DataType ln2_hi = 6.93147180369123816490e-01;
+  constexpr DataType ln2_lo = 1.90821492927058770002e-10;
+
+  // Scale the subnormal lanes so that the exponent field is valid.
+  Simd y = x, e = 0;
+  auto subnormal = x < limits::min();
+  where(subnormal, y) = x * magic;
+  where(subnormal, e) = DataType(-digits);
+
+  // Extract the exponent field as floating values by the magic number
+  // trick, which avoids the (possibly scalar) integer conversions. The
+  // mantissa is obtained by resetting the exponent field to the bias.
+  using stdx::__proposed::simd_bit_cast;
+  IntSimd bits = simd_bit_cast<IntSimd>(y);
+  e += simd_bit_cast<Simd>((bits >> digits) | simd_bit_cast<IntSimd>(
+    Simd(magic))) - (magic + bias);
+  Simd m = simd_bit_cast<Simd>((bits & mantissa_mask) | (bias << digits));
+
+  // Shift the mantissa from [0.5, 1) to [sqrt(1/2), sqrt(2)).
+  auto shift = m < sqrt_half;
+  where(shift, m) = m + m;
+  where(shift, e) = e - 1;
+
+  // The series is evaluated by the Estrin scheme instead of the Horner
+  // scheme, which shortens the dependency chain of multiplications.
+  Simd s = (m - 1) / (m + 1), z = s * s, z2 = z * z, p;
+  auto c = [](int k) { return 1 / DataType(2 * k + 1); };
+  if constexpr (sizeof(DataType) > sizeof(float)) {
+    Simd z4 = z2 * z2;
+    p = z * ((c(1) + c(2) * z) + (c(3) + c(4) * z) * z2
+      + ((c(5) + c(6) * z) + (c(7) + c(8) * z) * z2 + c(9) * z4) * z4);
+  } else
+    p = z * ((c(1) + c(2) * z) + (c(3) + c(4) * z) * z2);
+  Simd result = e * ln2_hi + (2 * s * (1 + p) + e * ln2_lo);
+
+  // Special values, which are rarely hit in practice.
+  if (stdx::any_of(!(x > 0 && x < limits::infinity()))) [[unlikely]] {
+    where(x == 0, result) = -limits::infinity();
+    where(x == limits::infinity(), result) = x;
+    where(x < 0 || x != x, result) = limits::quiet_NaN();
+  }
+  return result;
+}
+
+/**
+ * @brief The element-wise natural logarithm in extended precision, which
+ *  has no vector instructions. Each lane takes the scalar logarithm.
+ */
+template<class Simd>
+requires vectorized<Simd> &&
+    (sizeof(typename Simd::value_type) > sizeof(double))
+inline auto log(const Simd& x) -> Simd {
+  return Simd([&](auto lane) { return std::log(x[lane]); });
+}
+
+} // namespace simd
+
+} // namespace fiocca
+
+#endif // FIOCCA_SIMD_HPP_
@@ -4,6 +4,7 @@
 #include <ranges>
 #include <algorithm>
 #include <memory>
+#include <functional>
 
 namespace std {
 
@@ -1,7 +1,111 @@
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
 #include "expected_dist.hpp"
+#include "expected_dist_dispatch.hpp"
+
+// The kernel tables of the variants compiled by CMake, see
+// src/isa/kernels.cpp.
+#ifdef FIOCCA_ISA_GENERIC_AVAILABLE_
+extern const fiocca::dispatch::KernelTable fiocca_kernels_generic;
+#endif
+#ifdef FIOCCA_ISA_SSE2_AVAILABLE_
+extern const fiocca::dispatch::KernelTable fiocca_kernels_sse2;
+#endif
+#ifdef FIOCCA_ISA_AVX2_AVAILABLE_
+extern const fiocca::dispatch::KernelTable fiocca_kernels_avx2;
+#endif
+#ifdef FIOCCA_ISA_AVX512_AVAILABLE_
+extern const fiocca::dispatch::KernelTable fiocca_kernels_avx512;
+#endif
 
 namespace fiocca {
 
+namespace dispatch {
 
-} // namespace fiocca
+namespace {
+
+// The instruction sets from the widest one.
+constexpr Isa isas[] = { Isa::avx512, Isa::avx2, Isa::sse2, Isa::generic };
+
+auto _table(Isa isa) -> const KernelTable* {
+  switch (isa) {
+#ifdef FIOCCA_ISA_GENERIC_AVAILABLE_
+  case Isa::generic: return &fiocca_kernels_generic;
+#endif
+#ifdef FIOCCA_ISA_SSE2_AVAILABLE_
+  case Isa::sse2: return &fiocca_kernels_sse2;
+#endif
+#ifdef FIOCCA_ISA_AVX2_AVAILABLE_
+  case Isa::avx2: return &fiocca_kernels_avx2;
+#endif
+#ifdef FIOCCA_ISA_AVX512_AVAILABLE_
+  case Isa::avx512: return &fiocca_kernels_avx512;
+#endif
+  default: return nullptr;
+  }
+}
+
+// Whether the host supports @isa, by cpuid on x86.
+auto _cpu_supports(Isa isa) -> bool {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  switch (isa) {
+  case Isa::generic: return true;
+  case Isa::sse2: return __builtin_cpu_supports("sse2");
+  case Isa::avx2:
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  case Isa::avx512:
+    return __builtin_cpu_supports("avx512f")
+        && __builtin_cpu_supports("avx512dq")
+        && __builtin_cpu_supports("avx512vl")
+        && __builtin_cpu_supports("avx512bw");
+  }
+  return false;
+#else
+  return isa == Isa::generic;
+#endif
+}
+
+// The widest supported variant, or the one named by FIOCCA_ISA.
+auto _select() -> const KernelTable* {
+  if (const char* name = std::getenv("FIOCCA_ISA"))
+    for (Isa isa : isas)
+      if (!std::strcmp(name, isa_name(isa)) && supported(isa))
+        return _table(isa);
+  for (Isa isa : isas) if (supported(isa)) return _table(isa);
+  return nullptr;
+}
+
+auto _active() -> std::atomic<const KernelTable*>& {
+  static std::atomic<const KernelTable*> active { _select() };
+  return active;
+}
+
+// Select the kernels when the library is loaded.
+[[maybe_unused]] const auto& loaded = _active();
 
+} // namespace
+
+auto kernels() -> const KernelTable& {
+  return *_active().load(std::memory_order_relaxed);
+}
+
+auto active_isa() -> Isa { return kernels().isa; }
+
+auto isa_name(Isa isa) -> const char* {
+  constexpr const char* names[] = { "generic", "sse2", "avx2", "avx512" };
+  return names[static_cast<int>(isa)];
+}
+
+auto supported(Isa isa) -> bool { return _table(isa) && _cpu_supports(isa); }
+
+auto select_isa(Isa isa) -> bool {
+  if (!supported(isa)) return false;
+  _active().store(_table(isa), std::memory_order_relaxed);
+  return true;
+}
+
+} // namespace dispatch
+
+} // namespace fiocca
@@ -0,0 +1,87 @@
+// The kernels compiled for the instruction set FIOCCA_ISA, one of the
+// variants built by CMake, and selected by src/expected_dist.cpp at load
+// time. The headers are included into the namespace fiocca_isa_FIOCCA_ISA
+// instead of fiocca, so that the inline functions and templates compiled
+// for different instruction sets never merge in the linker. The inline
+// functions of the standard library keep their names, so each variant is
+// a shared object whose symbols are local except for its kernel table, see
+// kernels.map. The instrumentation is included before the renaming, and
+// its registry is exported, so that the probes of all variants share it.
+#include "kernel_table.hpp"
+#include "instrument.hpp"
+
+using isa_t = fiocca::dispatch::Isa;
+using kernel_table_t = fiocca::dispatch::KernelTable;
+template<class DataType>
+using kernels_t = fiocca::dispatch::Kernels<DataType>;
+
+#define FIOCCA_CONCAT_IMPL_(a, b) a##b
+#define FIOCCA_CONCAT_(a, b) FIOCCA_CONCAT_IMPL_(a, b)
+#define fiocca FIOCCA_CONCAT_(fiocca_isa_, FIOCCA_ISA)
+#include "rect.hpp"
+#include "expected_dist.hpp"
+#include "expected_dist_batch.hpp"
+#include "numeric_integral.hpp"
+
+namespace fiocca {
+
+namespace {
+
+template<class DataType>
+auto dist(const DataType* coords, DataType tolerance) -> DataType {
+  return expected_dist(Rect<DataType>(coords[0], coords[1],
+                                      coords[2], coords[3]),
+                       Rect<DataType>(coords[4], coords[5],
+                                      coords[6], coords[7]), tolerance);
+}
+
+template<class DataType>
+void dist_batch(const DataType* const* columns, std::size_t size,
+                DataType* result, DataType tolerance) {
+  auto column = [&](std::size_t k) {
+    return std::span<const DataType>(columns[k], size);
+  };
+  expected_dist(RectSpan<DataType> { column(0), column(1),
+                                     column(2), column(3) },
+                RectSpan<DataType> { column(4), column(5),
+                                     column(6), column(7) },
+                std::span<DataType>(result, size), tolerance);
+}
+
+template<class DataType>
+auto trapezoid(DataType (*integrand)(DataType, void*), void* context,
+               DataType min, DataType max, std::size_t ngrid) -> DataType {
+  return integral::trapezoid(
+    [=](DataType x) { return integrand(x, context); }, min, max, ngrid);
+}
+
+template<class DataType>
+auto simpson(DataType (*integrand)(DataType, void*), void* context,
+             DataType min, DataType max, std::size_t ngrid) -> DataType {
+  return integral::simpson(
+    [=](DataType x) { return integrand(x, context); }, min, max, ngrid);
+}
+
+template<class DataType>
+auto romberg(DataType (*integrand)(DataType, void*), void* context,
+             DataType min, DataType max, DataType accuracy,
+             std::size_t max_steps) -> DataType {
+  return integral::romberg(
+    [=](DataType x) { return integrand(x, context); },
+    min, max, accuracy, max_steps);
+}
+
+template<class DataType>
+constexpr kernels_t<DataType> kernels {
+  dist<DataType>, dist_batch<DataType>, trapezoid<DataType>,
+  simpson<DataType>, romberg<DataType>
+};
+
+} // namespace
+
+} // namespace fiocca
+
+extern const kernel_table_t FIOCCA_CONCAT_(fiocca_kernels_, FIOCCA_ISA) {
+  isa_t::FIOCCA_ISA,
+  fiocca::kernels<float>, fiocca::kernels<double>
+};
@@ -0,0 +1,61 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <charconv>
+#include "expected_dist_file.hpp"
+using namespace fiocca;
+
+// Usage:
+//   edist_file <input> <output> [window]
+// Evaluates the pairs of rectangles in the batch file <input> into the
+// expected distances in <output>, see BatchHeader for the layout. The
+// pairs are mapped and evaluated by the batch kernel in windows of at most
+// [window] pairs (2^20 by default), so that the files may exceed memory.
+
+namespace {
+
+void usage(std::ostream& out) {
+  out << "usage: edist_file <input> <output> [window]\n"
+         "  input   batch file of pairs of rectangles\n"
+         "  output  batch file of expected distances, overwritten\n"
+         "  window  pairs mapped at a time (default 1048576)\n";
+}
+
+} // namespace
+
+auto main(int argc, char* argv[]) -> int {
+  if (argc > 1 && (std::string(argv[1]) == "--help"
+                   || std::string(argv[1]) == "-h")) {
+    usage(std::cout);
+    return 0;
+  }
+  if (argc < 3 || argc > 4) {
+    usage(std::cerr);
+    return 1;
+  }
+  std::size_t window = 1 << 20;
+  if (argc == 4) {
+    const std::string value = argv[3];
+    const char* last = value.data() + value.size();
+    auto [ ptr, ec ] = std::from_chars(value.data(), last, window);
+    if (ec != std::errc() || ptr != last || window == 0) {
+      std::cerr << "invalid window " << value << std::endl;
+      usage(std::cerr);
+      return 1;
+    }
+  }
+
+  // Malformed or inaccessible files are reported rather than aborting.
+  try {
+    auto t1 = std::chrono::steady_clock::now();
+    std::size_t count = expected_dist_file(argv[1], argv[2], window);
+    auto t2 = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(t2 - t1).count();
+    std::cout << count << " pairs in " << seconds << "s, "
+              << count / seconds / 1e6 << "M pairs/s" << std::endl;
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}